@@ -0,0 +1,38 @@
+#pragma once
+#include <decentralized_path_auction/path_sync.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace decentralized_path_auction {
+
+// maps dense agent indices to agent ids and path sync entries and back
+class AgentIndex {
+public:
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    void clear();
+    // register id as the next agent index
+    size_t insert(const std::string& id);
+    // cache the path sync entry of agent, entries stay valid until removed from path sync
+    void bind(size_t idx, const PathSync& path_sync);
+
+    // find index of agent id (ie. a bidder), does not allocate
+    size_t find(const std::string& id) const;
+
+    size_t size() const { return _ids.size(); }
+    const std::string& getId(size_t idx) const { return _ids[idx]; }
+    const PathSync::PathInfo* getPathInfo(size_t idx) const { return _path_infos[idx]; }
+    // returns an empty path if agent has no path sync entry
+    const Path& getPath(size_t idx) const;
+
+private:
+    std::vector<std::string> _ids;
+    std::vector<const PathSync::PathInfo*> _path_infos;
+    std::unordered_map<std::string, size_t> _indices;
+    // ids are the decimal string of their index, allows lookup by parsing instead of hashing
+    bool _dense = true;
+};
+
+}  // namespace decentralized_path_auction
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace swarm_sim {
+
+constexpr size_t NOT_ASSIGNED = SIZE_MAX;
+
+// minimum cost assignment of rows to columns with the hungarian method in O(n^2 m)
+// costs are row major, returns the assigned column of each row
+// rows are left NOT_ASSIGNED when there are more rows than columns
+std::vector<size_t> solveAssignment(const std::vector<float>& costs, size_t n_rows, size_t n_cols);
+
+}  // namespace swarm_sim
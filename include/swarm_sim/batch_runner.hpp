@@ -0,0 +1,87 @@
+#pragma once
+#include <swarm_sim/bin_router.hpp>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace swarm_sim {
+
+// seeded requests of distinct bins to distinct parkable cells
+std::vector<BinRouter::BinRequest> generateRequests(
+        const MapGen& map, size_t n_requests, uint32_t seed);
+
+// solves many independent BinRouter scenarios concurrently and aggregates their results
+class BatchRunner {
+public:
+    enum Error {
+        SUCCESS,
+        FILE_OPEN_FAIL,
+        SCENARIO_PARSE_FAIL,
+    };
+
+    struct Config {
+        // total threads shared by all scenarios, 0 for the hardware concurrency
+        size_t n_threads = 0;
+        // scenarios solved at the same time, 0 to fit the most planner threads any
+        // scenario asks for into n_threads, planner threads are capped to the remainder
+        size_t n_parallel = 0;
+    };
+
+    struct Scenario {
+        std::string name;
+        BinRouter::Config config;
+        // explicit requests followed by n_random_requests generated from request_seed
+        std::vector<BinRouter::BinRequest> requests;
+        size_t n_random_requests = 0;
+        uint32_t request_seed = 0;
+        // csv output of the planned stages, discarded if empty
+        std::string output_file;
+        // compiled map to start from instead of generating one from the config
+        std::string snapshot_file;
+    };
+
+    struct Result {
+        std::string name;
+        BinRouter::Error error;
+        // planner threads the scenario was solved with
+        size_t n_threads;
+        // wall times in seconds
+        double map_gen_time;
+        double solve_time;
+        BinRouter::Stats stats;
+    };
+
+    // scenario with the config defaults of the scenario file
+    static Scenario defaultScenario();
+
+    BatchRunner(Config config);
+
+    // one scenario per line as space separated key=value pairs, # starts a comment
+    // unset keys keep the defaults, request=bin:col:row:floor may be repeated
+    // e.g. name=a rows=20 cols=20 floors=3 elevators=0:0,19:19 bins=800 bots=10 requests=16
+    // error_line is set to the first line that could not be parsed
+    Error loadScenarios(const char* file, size_t* error_line = nullptr);
+    Error parseScenarios(std::istream& input, size_t* error_line = nullptr);
+    void addScenario(Scenario scenario) { _scenarios.push_back(std::move(scenario)); }
+
+    // solve all scenarios, results are in scenario order
+    const std::vector<Result>& run();
+
+    // one csv row of timings and stats per result
+    Error saveResults(const char* file) const;
+
+    const std::vector<Scenario>& getScenarios() const { return _scenarios; }
+    const std::vector<Result>& getResults() const { return _results; }
+    // scenarios solved at the same time by the last run
+    size_t getParallelism() const { return _n_parallel; }
+
+private:
+    Result runScenario(const Scenario& scenario, size_t n_threads) const;
+
+    Config _config;
+    size_t _n_parallel = 0;
+    std::vector<Scenario> _scenarios;
+    std::vector<Result> _results;
+};
+
+}  // namespace swarm_sim
@@ -0,0 +1,39 @@
+#pragma once
+#include <swarm_sim/bin_router.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace swarm_sim {
+
+// thread safe queue of bin requests for BinRouter::stream
+class BinRequestQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        BinRouter::BinRequest request;
+        Clock::time_point time;
+    };
+
+    // can be called from any thread, requests pushed after close are dropped
+    void push(const BinRouter::BinRequest& request);
+    // no more requests will be pushed, stream returns once the queued ones are done
+    void close();
+
+    // wait until deadline or close then take every queued request
+    // returns false once the queue is closed
+    bool drain(Clock::time_point deadline, std::vector<Entry>& entries);
+
+    size_t size() const;
+
+private:
+    mutable std::mutex _mutex;
+    std::condition_variable _closed_cv;
+    std::deque<Entry> _entries;
+    bool _closed = false;
+};
+
+}  // namespace swarm_sim
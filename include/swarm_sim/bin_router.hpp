@@ -1,13 +1,22 @@
 #pragma once
 
+#include <swarm_sim/dependency_graph.hpp>
+#include <swarm_sim/evaluator.hpp>
 #include <swarm_sim/path_planner.hpp>
 #include <swarm_sim/map_gen.hpp>
+#include <swarm_sim/output_sink.hpp>
+#include <swarm_sim/travel_time.hpp>
+#include <array>
+#include <deque>
 #include <string>
 #include <unordered_map>
 
 namespace swarm_sim {
 using namespace decentralized_path_auction;
 
+class BinRequestQueue;
+class MapSnapshot;
+
 class BinRouter {
 public:
     enum Error {
@@ -18,6 +27,7 @@ public:
         REQUEST_BIN_NODE_NOT_PARKABLE,
         GENERATE_BIN_PATHS_FAIL,
         GENERATE_ROBOT_PATHS_FAIL,
+        TIME_LIMIT_REACHED,
     };
 
     enum DataEntryType {
@@ -32,10 +42,49 @@ public:
         float fallback_cost;
         float blocking_fallback_cost;
         size_t iterations;
+        // save each robot stage while the next one is planned, output is unchanged
+        bool pipelined = false;
+        // plan bins that stay on one floor with a planner per floor in parallel
+        // then stitch in the bins that change floors through the elevators
+        bool partition_floors = false;
+        // estimate cross floor costs with the detour through the nearest elevator
+        bool elevator_heuristic = true;
+        // assign bins to robots by estimated travel time before robot path planning
+        // each robot bids on its assigned bin and the next closest bins up to this many
+        // candidates, robots left without a bin get out of the way, 0 to disable
+        size_t assignment_candidates = 0;
+        // seconds from planBinPaths or a request change until planStages has to finish
+        // planner runs end at the deadline and defer the bins and robots that did not
+        // converge to later stages, stages completed by then are saved, 0 for no limit
+        double time_limit = 0;
         MultiPathPlanner::Config planner_config;
         MapGen::Config map_gen_config;
     };
 
+    // planner metrics and per agent results of one planning stage
+    struct StageStats {
+        MultiPathPlanner::Stats planner;
+        std::vector<MultiPathPlanner::Result> agents;
+        // quality of the committed paths of the stage
+        PlanMetrics metrics;
+    };
+
+    // wall times in seconds and replan counts of the last solve
+    struct Stats {
+        double bin_plan_time = 0;
+        double robot_plan_time = 0;
+        size_t bin_replans = 0;
+        size_t robot_replans = 0;
+        // dependency layers of the bin paths, lower bound on the number of robot stages
+        size_t bin_layers = 0;
+        // bin planning passes, bins deferred by one pass are planned again after its stages
+        size_t bin_passes = 0;
+        // stage 0 is bin planning followed by the robot planning stages
+        std::vector<StageStats> stages;
+        // robot stages run one after another, makespan is the time the last bin is delivered
+        PlanMetrics robot_metrics;
+    };
+
     struct BinRequest {
         size_t bin_id;
         size_t col;
@@ -43,31 +92,108 @@ public:
         size_t floor;
     };
 
+    // request latencies and queue depths of the last stream
+    struct StreamStats {
+        size_t cycles = 0;
+        // requests that were invalid or replaced by a later request of the same bin
+        size_t rejected = 0;
+        // seconds from push until the end of the cycle that delivered the bin
+        std::vector<double> latencies;
+        // requests drained from the queue by each cycle
+        std::vector<size_t> queue_depths;
+    };
+
     BinRouter(Config config);
+    // start from a compiled map instead of generating one, map_gen_config is ignored
+    BinRouter(Config config, const MapSnapshot& snapshot);
 
+    // writes csv output to save_file
     Error solve(const std::vector<BinRequest>& requests, const char* save_file);
+    Error solve(const std::vector<BinRequest>& requests, OutputSink& sink);
+
+    // solve is planBinPaths followed by planStages
+    Error planBinPaths(const std::vector<BinRequest>& requests);
+    Error planStages(OutputSink& sink);
+
+    // plan requests from the queue every horizon seconds against the current bin positions
+    // stages of every cycle are written to sink as they are planned, numbered continuously
+    // requests not delivered within a cycle are carried over to the next one
+    // returns once the queue is closed and every request was delivered or rejected
+    Error stream(BinRequestQueue& queue, OutputSink& sink, double horizon);
+
+    // change requests of the planned bin paths, keeps the paths of unaffected bins
+    // and only replans the changed bins and the bins they outbid
+    Error addBinRequests(const std::vector<BinRequest>& requests);
+    Error cancelBinRequests(const std::vector<size_t>& bin_ids);
 
     MapGen& getMap() { return _map; }
     const MapGen& getMap() const { return _map; }
+    const Stats& getStats() const { return _stats; }
+    // robot graph and planner reused by the stages planned on buffer, two when pipelined
+    const MapGen& getRobotMap(size_t buffer) const { return _robot_maps[buffer]; }
+    const MultiPathPlanner& getRobotPlanner(size_t buffer) const {
+        return _robot_path_planners[buffer];
+    }
+    const StreamStats& getStreamStats() const { return _stream_stats; }
 
 private:
-    float customTravelTime(const NodePtr& prev, const NodePtr& cur, const NodePtr& next);
+    Error validateRequest(const BinRequest& request, NodePtr& dst_node) const;
 
-    Error generateBinPaths(const std::vector<Nodes>& dst_vec);
-    Error generateRobotPaths(std::vector<int>::const_iterator& order_cur,
-            const std::vector<int>::const_iterator order_end);
-    void generateTraversalOrder(std::vector<int>& traversal_order, const PathSync& path_sync);
+    // plan requests from the current bin positions, keeping the previous paths of bins
+    // that neither moved nor changed their destination since the last plan
+    Error warmStartBinPaths(const std::vector<BinRequest>& requests);
+    // plans all bin paths or warm starts the changed ones if provided
+    Error generateBinPaths(const std::vector<size_t>* changed = nullptr);
+    void generatePartitionedBinPaths();
+    Error replanDeferredBins();
+    // plans stages numbered from stage, which is advanced past the last one
+    Error planStages(OutputSink& sink, int& stage);
 
-    void saveEntities(FILE* save_file, int stage);
-    void savePath(int id, const Path& path, FILE* save_file, int stage, bool under);
-    void savePaths(const PathSync& path_sync, FILE* save_file, int stage, bool under);
+    void startTimeLimit();
+    // planner config bounded by the deadline of the time limit
+    MultiPathPlanner::Config plannerConfig() const;
+    // robots pick up the given bins, bins that were carried to their destination are returned
+    Error generateRobotPaths(const std::vector<size_t>& bin_ids,
+            std::vector<size_t>& moved_bin_ids, size_t buffer);
+    void assignBins(const MapGen& robot_map, const Nodes& robot_locs, const Nodes& bin_locs,
+            std::vector<Nodes>& assigned_dsts) const;
+
+    void recordStage(const MultiPathPlanner& planner, const MapGen& robot_map);
+    void initThreadPool();
+
+    // snapshot of a robot stage for saving
+    struct StageOutput {
+        int stage = 0;
+        Nodes bins;
+        Nodes bots;
+        std::vector<size_t> bin_ids;
+        size_t buffer = 0;
+    };
+
+    void saveStage(OutputSink& sink, const StageOutput& output);
+    void saveEntities(OutputSink& sink, int stage, const Nodes& bins, const Nodes& bots);
+    void savePath(int id, const Path& path, OutputSink& sink, int stage, bool under);
+    void savePaths(const MultiPathPlanner& planner, OutputSink& sink, int stage, bool under);
 
     MultiPathPlanner _bin_path_planner;
-    MultiPathPlanner _robot_path_planner;
+    std::deque<MultiPathPlanner> _floor_path_planners;
+    std::vector<std::vector<MultiPathPlanner::Request>> _floor_path_requests;
+    std::array<MultiPathPlanner, 2> _robot_path_planners;
+    std::shared_ptr<ThreadPool> _thread_pool;
     std::vector<MultiPathPlanner::Request> _path_requests;
 
+    // bin routing problem of the last planBinPaths
+    Nodes _bin_sources;
+    Nodes _bot_sources;
+    std::vector<Nodes> _bin_destinations;
+
     Config _config;
+    Stats _stats;
+    StreamStats _stream_stats;
+    std::chrono::steady_clock::time_point _deadline = std::chrono::steady_clock::time_point::max();
     MapGen _map;
+    // empty copies of the map for robot stages, reused across stages
+    std::vector<MapGen> _robot_maps;
 };
 
 }  // namespace swarm_sim
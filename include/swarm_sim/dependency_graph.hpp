@@ -0,0 +1,48 @@
+#pragma once
+#include <swarm_sim/path_planner.hpp>
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace swarm_sim {
+
+using namespace decentralized_path_auction;
+
+// order in which planned paths can be carried out, a path depends on the agents
+// holding higher bids on its nodes and becomes ready once all of them completed
+class DependencyGraph {
+public:
+    // build from the committed paths of planner, agents without a moving path are left out
+    // dependencies that form a cycle are dropped in depth first order
+    void build(const MultiPathPlanner& planner) {
+        build(planner.getPathSync(), planner.getAgentIndex());
+    }
+    void build(const PathSync& path_sync, const AgentIndex& agent_index);
+
+    // take up to n ready agents, lowest dependency layer first
+    void takeReady(size_t n, std::vector<size_t>& agents);
+    // return a taken agent that did not complete to the ready set
+    void retry(size_t agent);
+    // complete a taken agent, agents depending on it may become ready
+    void complete(size_t agent);
+
+    bool done() const { return !_remaining; }
+    size_t getLayer(size_t agent) const { return _layers[agent]; }
+    size_t getLayerCount() const { return _n_layers; }
+
+private:
+    static constexpr size_t NOT_SCHEDULED = SIZE_MAX;
+
+    std::vector<std::vector<size_t>> _dependents;
+    std::vector<size_t> _pending;
+    std::vector<size_t> _layers;
+    // depth first finishing position, breaks ties within a layer
+    std::vector<size_t> _positions;
+    // ready agents ordered by layer and position
+    std::set<std::tuple<size_t, size_t, size_t>> _ready;
+    size_t _n_layers = 0;
+    size_t _remaining = 0;
+};
+
+}  // namespace swarm_sim
@@ -0,0 +1,54 @@
+#pragma once
+#include <swarm_sim/path_planner.hpp>
+#include <swarm_sim/travel_time.hpp>
+#include <vector>
+
+namespace swarm_sim {
+
+// times of one agent's path in the travel time units of the planner
+struct AgentMetrics {
+    // time spent moving and riding elevators
+    float travel_time = 0;
+    // time spent waiting for agents ahead in the auctions of the path
+    float wait_time = 0;
+    // time the agent reaches the end of its path
+    float finish_time = 0;
+    size_t elevator_rides = 0;
+};
+
+// quality of the paths of a stage, or of consecutive stages combined with append
+struct PlanMetrics {
+    // time until the last agent reached the end of its path
+    float makespan = 0;
+    float travel_time = 0;
+    float wait_time = 0;
+    size_t elevator_rides = 0;
+    // part of wait_time spent queueing to enter an elevator
+    float elevator_wait_time = 0;
+    // rides per elevator of the map
+    std::vector<size_t> elevator_usage;
+    std::vector<AgentMetrics> agents;
+
+    // add the metrics of a stage that starts once this one has finished
+    void append(const PlanMetrics& next);
+};
+
+// evaluates committed paths with the travel time the planner searched them with
+// visit times are the arrival times estimated by the search, any time between two visits
+// beyond the travel time between them is waiting for the agents that bid higher
+class Evaluator {
+public:
+    Evaluator(const MapGen& map, float elevator_duration)
+            : _map(map)
+            , _travel_time{elevator_duration, nullptr} {}
+
+    AgentMetrics evaluate(const Path& path, PlanMetrics* metrics = nullptr) const;
+    // metrics of the paths held in the planner's PathSync, agents in request order
+    PlanMetrics evaluate(const MultiPathPlanner& planner) const;
+
+private:
+    const MapGen& _map;
+    WarehouseTravelTime _travel_time;
+};
+
+}  // namespace swarm_sim
@@ -2,6 +2,10 @@
 #include <decentralized_path_auction/graph.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <optional>
 #include <random>
 #include <vector>
 
@@ -9,6 +13,8 @@ namespace swarm_sim {
 
 using namespace decentralized_path_auction;
 
+class MapSnapshot;
+
 struct MapGen {
     struct Config {
         size_t rows;
@@ -17,9 +23,65 @@ struct MapGen {
         size_t n_bins;
         size_t n_bots;
         std::vector<std::pair<size_t, size_t>> elevators;
+        // seed of bin and bot placement, random if not set
+        std::optional<uint32_t> seed = std::nullopt;
+    };
+
+    // grid coordinates of a node, every node's custom_data points to its attributes
+    struct NodeAttributes {
+        uint32_t col;
+        uint32_t row;
+        uint32_t floor;
+        bool elevator;
     };
 
     MapGen(const Config& config);
+    // rebuild a compiled map without recomputing its tables, bins and bots are optional
+    MapGen(const MapSnapshot& snapshot, bool place_entities = true);
+
+    // node custom_data points into node_attributes, a copy would point back into the source
+    // moving keeps the attribute storage and with it the pointers valid
+    MapGen(const MapGen&) = delete;
+    MapGen& operator=(const MapGen&) = delete;
+    MapGen(MapGen&&) = default;
+    MapGen& operator=(MapGen&&) = default;
+
+    static const NodeAttributes& attributes(const NodePtr& node) {
+        assert(node->custom_data);
+        return *static_cast<const NodeAttributes*>(node->custom_data);
+    }
+
+    // node at grid coordinates, elevator nodes are shared by every floor
+    // returns nullptr if coordinates are out of range
+    NodePtr at(size_t col, size_t row, size_t floor) const;
+    // node at position rounded to the nearest grid coordinates
+    NodePtr find(const Point& position) const;
+
+    // shortest floor distance from a to b through any elevator, excluding the elevator ride
+    // falls back to manhattan distance when no elevator is reachable
+    float elevatorDetour(const NodeAttributes& a, const NodeAttributes& b) const {
+        size_t n = elevators.size();
+        const float* a_dists = &elevator_distances[(a.col + a.row * cols) * n];
+        const float* b_dists = &elevator_distances[(b.col + b.row * cols) * n];
+        float detour = FLT_MAX;
+        for (size_t i = 0; i < n; ++i) {
+            detour = std::min(detour, a_dists[i] + b_dists[i]);
+        }
+        return detour < FLT_MAX ? detour
+                                : std::abs(static_cast<float>(a.col) - b.col) +
+                                          std::abs(static_cast<float>(a.row) - b.row);
+    }
+
+    size_t cols;
+    size_t rows;
+    size_t floors;
+    // dense grid of nodes indexed by col + row * cols + floor * cols * rows
+    Nodes grid;
+    // attributes of each grid cell, elevators use the entry of their first floor cell
+    std::vector<NodeAttributes> node_attributes;
+    // floor distance of each col, row cell to each elevator, indexed by cell * elevators + i
+    // found by breadth first search not passing through other elevators, FLT_MAX if unreachable
+    std::vector<float> elevator_distances;
 
     Graph graph;
     Nodes elevators;
@@ -0,0 +1,64 @@
+#pragma once
+#include <swarm_sim/map_gen.hpp>
+#include <cstdint>
+
+namespace swarm_sim {
+
+// memory mapped read only view of a map compiled by MapSnapshot::save
+//
+// layout: Header followed by 8 byte aligned arrays of
+// nodes[cells], states[cells], attributes[cells], edge_offsets[cells + 1], edges[edges],
+// elevators[elevators], elevator_distances[cols * rows * elevators], bins[bins], bots[bots]
+// nodes maps each grid cell to the cell that owns its node, elevator cells share the first
+// floor cell, edges and states are only stored for owner cells, all node references are cells
+class MapSnapshot {
+public:
+    static constexpr char MAGIC[8] = {'S', 'W', 'S', 'I', 'M', 'M', 'A', 'P'};
+    static constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t cols;
+        uint32_t rows;
+        uint32_t floors;
+        uint64_t n_cells;
+        uint64_t n_edges;
+        uint64_t n_elevators;
+        uint64_t n_bins;
+        uint64_t n_bots;
+    };
+
+    // compile the nodes, states, edges and tables of map into file
+    static bool save(const MapGen& map, const char* file);
+
+    MapSnapshot(const char* file);
+    ~MapSnapshot();
+
+    MapSnapshot(const MapSnapshot&) = delete;
+    MapSnapshot& operator=(const MapSnapshot&) = delete;
+
+    // false if the file could not be mapped, its sizes do not match its header or any of its
+    // node references, attributes or distances are out of range
+    bool good() const { return _data; }
+    const Header& getHeader() const { return *reinterpret_cast<const Header*>(_data); }
+
+    const uint32_t* nodes = nullptr;
+    const uint8_t* states = nullptr;
+    const MapGen::NodeAttributes* attributes = nullptr;
+    const uint64_t* edge_offsets = nullptr;
+    const uint32_t* edges = nullptr;
+    const uint32_t* elevators = nullptr;
+    const float* elevator_distances = nullptr;
+    const uint32_t* bins = nullptr;
+    const uint32_t* bots = nullptr;
+
+private:
+    bool validate() const;
+    void unmap();
+
+    const char* _data = nullptr;
+    size_t _size = 0;
+};
+
+}  // namespace swarm_sim
@@ -0,0 +1,151 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace swarm_sim {
+
+struct OutputEntry {
+    int32_t stage;
+    int32_t type;
+    int32_t id;
+    float x;
+    float y;
+    float z;
+    float t;
+};
+
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    // entities are snapshotted every stage, sinks may store them as deltas
+    virtual void writeEntity(const OutputEntry& entry) = 0;
+    virtual void writePath(const OutputEntry& entry) = 0;
+    // complete all pending writes
+    virtual void flush() {}
+    virtual bool good() const = 0;
+};
+
+// discards all entries
+class NullSink : public OutputSink {
+public:
+    void writeEntity(const OutputEntry&) override {}
+    void writePath(const OutputEntry&) override {}
+    bool good() const override { return true; }
+};
+
+// comma separated rows as read by plot.py
+class CsvSink : public OutputSink {
+public:
+    CsvSink(const char* file);
+    ~CsvSink();
+
+    void writeEntity(const OutputEntry& entry) override;
+    void writePath(const OutputEntry& entry) override;
+    void flush() override;
+    bool good() const override { return _file; }
+
+private:
+    FILE* _file;
+};
+
+// binary file of column blocks, entity rows are only written when they changed
+//
+// layout: magic, then blocks of {n_rows, kind} followed by the columns
+// stage, type, id, x, y, z, t each stored as n_rows 4 byte values
+class BinarySink : public OutputSink {
+public:
+    static constexpr char MAGIC[8] = {'S', 'W', 'S', 'I', 'M', 'B', 'I', '1'};
+    enum BlockKind : uint32_t { ENTITIES, PATHS };
+
+    BinarySink(const char* file, size_t block_rows = 4096);
+    ~BinarySink();
+
+    void writeEntity(const OutputEntry& entry) override;
+    void writePath(const OutputEntry& entry) override;
+    void flush() override;
+    bool good() const override { return _file; }
+
+private:
+    void writeBlock(std::vector<OutputEntry>& rows, BlockKind kind);
+
+    FILE* _file;
+    size_t _block_rows;
+    std::vector<OutputEntry> _entities;
+    std::vector<OutputEntry> _paths;
+    // last written entry of each (type, id) entity
+    std::map<std::pair<int32_t, int32_t>, OutputEntry> _last_entities;
+};
+
+// memory mapped reader of files written by BinarySink
+class BinaryReader {
+public:
+    struct Block {
+        BinarySink::BlockKind kind;
+        size_t n_rows;
+        const int32_t* stage;
+        const int32_t* type;
+        const int32_t* id;
+        const float* x;
+        const float* y;
+        const float* z;
+        const float* t;
+    };
+
+    BinaryReader(const char* file);
+    ~BinaryReader();
+
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
+    bool good() const { return _data; }
+    const std::vector<Block>& getBlocks() const { return _blocks; }
+
+    // entity positions at stage, reconstructed from the deltas of all previous stages
+    std::vector<OutputEntry> getEntities(int32_t stage) const;
+    std::vector<OutputEntry> getPaths(int32_t stage) const;
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+    std::vector<Block> _blocks;
+};
+
+// forwards entries to another sink on a background writer thread
+class AsyncSink : public OutputSink {
+public:
+    AsyncSink(std::unique_ptr<OutputSink> sink);
+    ~AsyncSink();
+
+    void writeEntity(const OutputEntry& entry) override;
+    void writePath(const OutputEntry& entry) override;
+    void flush() override;
+    bool good() const override { return _sink->good(); }
+
+private:
+    struct Pending {
+        bool entity;
+        OutputEntry entry;
+    };
+
+    void push(bool entity, const OutputEntry& entry);
+    void writerLoop();
+
+    std::unique_ptr<OutputSink> _sink;
+    std::vector<Pending> _pending;
+    std::mutex _mutex;
+    std::condition_variable _pending_cv;
+    std::condition_variable _idle_cv;
+    bool _busy = false;
+    bool _stop = false;
+    std::thread _writer;
+};
+
+}  // namespace swarm_sim
@@ -1,7 +1,15 @@
 #pragma once
 #include <decentralized_path_auction/path_search.hpp>
 #include <decentralized_path_auction/path_sync.hpp>
+#include <swarm_sim/agent_index.hpp>
+#include <swarm_sim/thread_pool.hpp>
+#include <swarm_sim/tracer.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <thread>
+#include <unordered_map>
 #include <shared_mutex>
 
 namespace decentralized_path_auction {
@@ -15,6 +23,9 @@ public:
     // getters
     PathSearch& getPathSearch() { return _path_search; }
     const Path& getPath() const { return _path; }
+    void resetPath() { _path.clear(); }
+    void setPath(Path path) { _path = std::move(path); }
+    Path releasePath() { return std::move(_path); }
     const std::string& getId() const { return _path_search.getConfig().agent_id; }
 
     struct PlanArgs {
@@ -35,12 +46,28 @@ class MultiPathPlanner {
 public:
     struct Config {
         size_t rounds;
+        // capped at one more than the size of a provided thread pool
         size_t n_threads = std::thread::hardware_concurrency();
         bool allow_indefinite_block = true;
+        // pin worker threads to these cpus when the planner creates its own thread pool
+        std::vector<int> cpu_affinity = {};
+        // seconds a run may take and the latest time it may end, whichever comes first
+        // agents whose paths are not conflict free by then are deferred, 0 for no limit
+        double time_limit = 0;
+        std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::time_point::max();
+        // threads queue replanned paths and one thread at a time commits the queue under a
+        // single exclusive lock once it holds this many or the committing thread runs idle
+        // paths whose auctions changed after they were planned are rejected and replanned
+        // rejections count against rounds, 0 commits every replan under its own lock
+        size_t commit_batch = 0;
+        // count search iterations per agent, wraps the travel time of every search
+        bool count_iterations = false;
     };
 
     struct Request {
-        Nodes dst;
+        // destination sets are immutable and can be shared by many agents
+        std::shared_ptr<const Nodes> dst;
         float duration;
         PathSearch::Config config;
         PathPlanner::PlanArgs args;
@@ -49,26 +76,161 @@ public:
     struct Result {
         PathSearch::Error search_error = PathSearch::SUCCESS;
         PathSync::Error sync_error = PathSync::SUCCESS;
+        // number of replans, nodes expanded by the search if counted and seconds spent replanning
+        size_t replans = 0;
+        size_t iterations = 0;
+        double replan_time = 0;
+        // run ended before the agent's path was conflict free, its path only holds its source
+        // agents that cannot bid to stay at their source keep their path and sync error
+        bool deferred = false;
     };
 
+    enum Convergence {
+        CONVERGED,
+        ROUNDS_EXHAUSTED,
+        SEARCH_FAILED,
+        DEADLINE_REACHED,
+    };
+
+    // seconds spent waiting to acquire each lock type and number of commits
+    struct ThreadStats {
+        double shared_wait_time = 0;
+        double exclusive_wait_time = 0;
+        size_t commits = 0;
+    };
+
+    struct Stats {
+        std::vector<ThreadStats> threads;
+        size_t commits = 0;
+        // batched commit mode only, stale paths rejected and batches committed
+        size_t rejected = 0;
+        size_t batches = 0;
+        // commits per agent
+        float rounds = 0;
+        Convergence convergence = ROUNDS_EXHAUSTED;
+        double wall_time = 0;
+    };
+
+    // planner creates its own thread pool on first use if none is provided
+    MultiPathPlanner(std::shared_ptr<ThreadPool> thread_pool = nullptr)
+            : _thread_pool(std::move(thread_pool)) {}
+
     PathSearch::Error plan(const Config& config, const std::vector<Request>& requests);
+    // set up planners and destinations without planning, requests must outlive the planner
+    PathSearch::Error initialize(
+            const std::vector<Request>& requests, bool count_iterations = false);
+    // move committed paths of another planner over to the given agents of this one
+    // the other planner's requests must be the given subset of this planner's requests
+    // config is the one the following replan runs with
+    void importPaths(
+            const Config& config, MultiPathPlanner& other, const std::vector<size_t>& agents);
+    // warm start from the previous plan, only the given agents take their new requests
+    // other agents keep their paths and get replanned only if the changed agents affect them
+    PathSearch::Error replan(const Config& config, const std::vector<Request>& requests,
+            const std::vector<size_t>& agents);
 
     const PathSync& getPathSync() const { return _path_sync; }
     PathSync& getPathSync() { return _path_sync; }
 
     const std::vector<Result>& getResults() const { return _results; }
+    const AgentIndex& getAgentIndex() const { return _agent_index; }
+    const Stats& getStats() const { return _stats; }
+
+    const std::shared_ptr<ThreadPool>& getThreadPool() const { return _thread_pool; }
+    void setThreadPool(std::shared_ptr<ThreadPool> thread_pool) {
+        _thread_pool = std::move(thread_pool);
+        _owns_thread_pool = false;
+    }
 
 private:
-    void thread_loop(size_t idx);
+    using Clock = std::chrono::steady_clock;
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> agents;
+    };
+
+    // replanned path waiting for the committer, version is the commit count it planned against
+    struct Candidate {
+        size_t idx;
+        PathSearch::Error search_error;
+        size_t version;
+    };
+
+    // plan all unsatisfied agents
+    PathSearch::Error run(const Config& config, const std::vector<Request>& requests,
+            Clock::time_point start);
+    void thread_loop(size_t thread_idx);
+    // apply a replanned path to path sync, requires exclusive lock
+    // returns false once the run is finished
+    bool commit(size_t thread_idx, size_t idx, PathSearch::Error search_error);
+    // commit the queued candidates unless another thread is already committing
+    void commitCandidates(size_t thread_idx);
+    // commit the swapped out candidates, requires the committer lock
+    void commitBatch(size_t thread_idx);
+    bool isStale(const Candidate& candidate) const;
+    // planners of candidates left over at the end of a run go back to their committed paths
+    void dropCandidates();
+    // keep unsatisfied agents at their source until the other paths are conflict free
+    void deferUnsatisfied();
+
+    // work queues of agents that need planning, idle threads steal from others
+    void pushAgent(size_t idx, bool priority);
+    bool popAgent(size_t thread_idx, size_t& idx);
+    // park until an agent is queued or the run is finished
+    void waitForAgents();
+    // end the run and wake all parked threads
+    void finish();
+
+    // convergence tracking, requires exclusive lock
+    bool checkSatisfied(size_t idx);
+    void updateSatisfied(size_t idx);
+    void markDirty(size_t idx);
+    void markDirty(const Path& path);
 
     PathSync _path_sync;
     std::vector<PathPlanner> _path_planners;
+    // cleared paths of previous plans, reused so path storage is not reallocated every plan
+    std::vector<Path> _path_buffers;
     std::vector<Result> _results;
+    std::shared_ptr<ThreadPool> _thread_pool;
+    // a provided pool is never replaced, the planner only grows the pool it created itself
+    bool _owns_thread_pool = false;
     const Request* _requests;
     Config _config;
 
     int _countdown;
+    Clock::time_point _deadline;
+    Stats _stats;
+    size_t _path_id;
+    std::atomic<bool> _finished;
+    std::unique_ptr<WorkQueue[]> _work_queues;
+    std::vector<uint8_t> _queued;
+    // queued agents over all work queues and threads parked waiting for them
+    std::atomic<size_t> _pending;
+    std::atomic<size_t> _idle_threads;
+    std::mutex _idle_mutex;
+    std::condition_variable _idle_cv;
     std::shared_mutex _shared_mutex;
+
+    // batched commit mode, candidates are swapped into the committing buffer by the committer
+    std::mutex _candidates_mutex;
+    std::mutex _committer_mutex;
+    std::vector<Candidate> _candidates;
+    std::vector<Candidate> _committing;
+    // commits applied so far and the version of the last commit that touched each agent
+    // and each node, nodes are only tracked in batched commit mode
+    size_t _version;
+    std::vector<size_t> _dirty_versions;
+    std::unordered_map<const Node*, size_t> _node_versions;
+
+    // agents that must be re-checked after a commit and the number of unsatisfied agents
+    AgentIndex _agent_index;
+    std::vector<uint8_t> _satisfied;
+    std::vector<size_t> _dirty_stamps;
+    std::vector<size_t> _dirty;
+    size_t _dirty_stamp;
+    size_t _unsatisfied;
 };
 
 }  // namespace decentralized_path_auction
@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace decentralized_path_auction {
+
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t)>;
+
+    // cpu_affinity maps worker i to cpu_affinity[i % size], empty disables pinning
+    ThreadPool(size_t n_threads, const std::vector<int>& cpu_affinity = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // run task(0) ... task(n_tasks - 1) and block until all of them returned
+    // the calling thread works on its own batch too, so nested runs cannot deadlock
+    void run(size_t n_tasks, const Task& task);
+
+    size_t size() const { return _threads.size(); }
+    const std::vector<int>& getCpuAffinity() const { return _cpu_affinity; }
+
+private:
+    struct Batch {
+        const Task* task;
+        size_t n_tasks;
+        size_t next = 0;
+        size_t done = 0;
+    };
+
+    void workerLoop(size_t idx);
+    // execute one task from batch, requires lock to be held and released during the task
+    void execute(std::unique_lock<std::mutex>& lock, Batch& batch);
+
+    std::vector<std::thread> _threads;
+    std::vector<int> _cpu_affinity;
+    std::deque<std::shared_ptr<Batch>> _batches;
+    std::mutex _mutex;
+    std::condition_variable _work_cv;
+    std::condition_variable _done_cv;
+    bool _stop = false;
+};
+
+}  // namespace decentralized_path_auction
@@ -0,0 +1,75 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// trace macros compile to nothing unless built with SWARM_SIM_TRACE
+// args are the event name followed by optional id and value
+#ifdef SWARM_SIM_TRACE
+#define SWARM_SIM_TRACE_BEGIN(...)                           \
+    ::decentralized_path_auction::Tracer::instance().record( \
+            ::decentralized_path_auction::Tracer::BEGIN, __VA_ARGS__)
+#define SWARM_SIM_TRACE_END(...)                             \
+    ::decentralized_path_auction::Tracer::instance().record( \
+            ::decentralized_path_auction::Tracer::END, __VA_ARGS__)
+#define SWARM_SIM_TRACE_INSTANT(...)                         \
+    ::decentralized_path_auction::Tracer::instance().record( \
+            ::decentralized_path_auction::Tracer::INSTANT, __VA_ARGS__)
+#else
+#define SWARM_SIM_TRACE_BEGIN(...) ((void) 0)
+#define SWARM_SIM_TRACE_END(...) ((void) 0)
+#define SWARM_SIM_TRACE_INSTANT(...) ((void) 0)
+#endif
+
+namespace decentralized_path_auction {
+
+// records events into per thread ring buffers without locking
+// the oldest events of a thread are overwritten once its buffer is full
+class Tracer {
+public:
+    enum Type : uint8_t {
+        BEGIN,
+        END,
+        INSTANT,
+    };
+
+    // name must be a string literal, id and value are exported as event args
+    struct Event {
+        const char* name;
+        int64_t id;
+        int64_t value;
+        int64_t time_ns;
+        Type type;
+    };
+
+    static Tracer& instance();
+
+    void record(Type type, const char* name, int64_t id = 0, int64_t value = 0);
+
+    // drop all events and set the ring buffer size of each thread
+    // not thread safe with record, only call when no traced code is running
+    void clear(size_t capacity = 1 << 16);
+
+    // write recorded events in chrome trace event json format (chrome://tracing, perfetto)
+    // not thread safe with record, only call when no traced code is running
+    bool exportChromeTrace(const char* file) const;
+
+private:
+    struct Buffer {
+        std::vector<Event> events;
+        size_t count = 0;
+        uint32_t thread_id;
+    };
+
+    Tracer();
+    Buffer& threadBuffer();
+
+    std::chrono::steady_clock::time_point _start;
+    size_t _capacity = 1 << 16;
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<Buffer>> _buffers;
+};
+
+}  // namespace decentralized_path_auction
@@ -0,0 +1,41 @@
+#pragma once
+#include <swarm_sim/map_gen.hpp>
+#include <cmath>
+
+namespace swarm_sim {
+
+// travel time on a MapGen graph from the node positions and precomputed node attributes
+// callers that know the policy type get it inlined, path search takes it as a std::function
+struct WarehouseTravelTime {
+    float elevator_duration;
+    // estimate cross floor distances through the nearest elevator of this map if set
+    const MapGen* map = nullptr;
+
+    float operator()(const NodePtr& prev, const NodePtr& cur, const NodePtr& next) const {
+        // coordinates are read from the node positions, only elevator flags need the attributes
+        bool cur_elevator = MapGen::attributes(cur).elevator;
+        // prev only exists for adjacent queries, adjacent nodes are one unit apart and only
+        // change floors by exiting an elevator
+        if (prev) {
+            return cur_elevator ? 1.0f + elevator_duration : 1.0f;
+        }
+        // otherwise estimate with 2D manhattan distance
+        auto& c = cur->position;
+        auto& n = next->position;
+        float t = std::abs(c.get<0>() - n.get<0>()) + std::abs(c.get<1>() - n.get<1>());
+        // add elevator duration if exiting elevator or floor changed
+        if (cur_elevator) {
+            return t + elevator_duration;
+        }
+        if (c.get<2>() == n.get<2>() || MapGen::attributes(next).elevator) {
+            return t;
+        }
+        // estimate cross floor distances through the nearest elevator
+        if (map) {
+            t = map->elevatorDetour(MapGen::attributes(cur), MapGen::attributes(next));
+        }
+        return t + elevator_duration;
+    }
+};
+
+}  // namespace swarm_sim
@@ -0,0 +1,47 @@
+#include <swarm_sim/agent_index.hpp>
+#include <charconv>
+
+namespace decentralized_path_auction {
+
+void AgentIndex::clear() {
+    _ids.clear();
+    _path_infos.clear();
+    _indices.clear();
+    _dense = true;
+}
+
+size_t AgentIndex::insert(const std::string& id) {
+    size_t idx = _ids.size();
+    _dense = _dense && id == std::to_string(idx);
+    _ids.push_back(id);
+    _path_infos.push_back(nullptr);
+    _indices.emplace(id, idx);
+    return idx;
+}
+
+void AgentIndex::bind(size_t idx, const PathSync& path_sync) {
+    auto found = path_sync.getPaths().find(_ids[idx]);
+    _path_infos[idx] = found == path_sync.getPaths().end() ? nullptr : &found->second;
+}
+
+size_t AgentIndex::find(const std::string& id) const {
+    if (!_dense) {
+        auto found = _indices.find(id);
+        return found == _indices.end() ? NOT_FOUND : found->second;
+    }
+    size_t idx;
+    const char* end = id.data() + id.size();
+    auto [ptr, ec] = std::from_chars(id.data(), end, idx);
+    // compare against id to reject non-canonical forms such as leading zeros
+    if (ec != std::errc() || ptr != end || idx >= _ids.size() || _ids[idx] != id) {
+        return NOT_FOUND;
+    }
+    return idx;
+}
+
+const Path& AgentIndex::getPath(size_t idx) const {
+    static const Path empty_path;
+    return _path_infos[idx] ? _path_infos[idx]->path : empty_path;
+}
+
+}  // namespace decentralized_path_auction
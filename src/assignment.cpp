@@ -0,0 +1,83 @@
+#include <swarm_sim/assignment.hpp>
+#include <cassert>
+#include <limits>
+
+namespace swarm_sim {
+
+std::vector<size_t> solveAssignment(const std::vector<float>& costs, size_t n_rows, size_t n_cols) {
+    assert(costs.size() == n_rows * n_cols);
+    // solve transposed problem if there are more rows than columns
+    if (n_rows > n_cols) {
+        std::vector<float> transposed(costs.size());
+        for (size_t row = 0; row < n_rows; ++row) {
+            for (size_t col = 0; col < n_cols; ++col) {
+                transposed[col * n_rows + row] = costs[row * n_cols + col];
+            }
+        }
+        std::vector<size_t> assignment(n_rows, NOT_ASSIGNED);
+        auto transposed_assignment = solveAssignment(transposed, n_cols, n_rows);
+        for (size_t col = 0; col < n_cols; ++col) {
+            assignment[transposed_assignment[col]] = col;
+        }
+        return assignment;
+    }
+
+    // row and column potentials, index 0 is a virtual column holding the row being added
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> u(n_rows + 1), v(n_cols + 1);
+    std::vector<size_t> col_rows(n_cols + 1), way(n_cols + 1);
+    std::vector<double> min_slack(n_cols + 1);
+    std::vector<uint8_t> used(n_cols + 1);
+    for (size_t row = 1; row <= n_rows; ++row) {
+        // find shortest augmenting path from the new row
+        col_rows[0] = row;
+        size_t col0 = 0;
+        min_slack.assign(n_cols + 1, inf);
+        used.assign(n_cols + 1, false);
+        do {
+            used[col0] = true;
+            size_t row0 = col_rows[col0];
+            size_t col1 = 0;
+            double delta = inf;
+            for (size_t col = 1; col <= n_cols; ++col) {
+                if (used[col]) {
+                    continue;
+                }
+                double slack = costs[(row0 - 1) * n_cols + col - 1] - u[row0] - v[col];
+                if (slack < min_slack[col]) {
+                    min_slack[col] = slack;
+                    way[col] = col0;
+                }
+                if (min_slack[col] < delta) {
+                    delta = min_slack[col];
+                    col1 = col;
+                }
+            }
+            for (size_t col = 0; col <= n_cols; ++col) {
+                if (used[col]) {
+                    u[col_rows[col]] += delta;
+                    v[col] -= delta;
+                } else {
+                    min_slack[col] -= delta;
+                }
+            }
+            col0 = col1;
+        } while (col_rows[col0]);
+        // flip assignments along the augmenting path
+        do {
+            size_t col1 = way[col0];
+            col_rows[col0] = col_rows[col1];
+            col0 = col1;
+        } while (col0);
+    }
+
+    std::vector<size_t> assignment(n_rows, NOT_ASSIGNED);
+    for (size_t col = 1; col <= n_cols; ++col) {
+        if (col_rows[col]) {
+            assignment[col_rows[col] - 1] = col - 1;
+        }
+    }
+    return assignment;
+}
+
+}  // namespace swarm_sim
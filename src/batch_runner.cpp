@@ -0,0 +1,300 @@
+#include <swarm_sim/batch_runner.hpp>
+#include <swarm_sim/map_snapshot.hpp>
+#include <swarm_sim/thread_pool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+namespace swarm_sim {
+
+std::vector<BinRouter::BinRequest> generateRequests(
+        const MapGen& map, size_t n_requests, uint32_t seed) {
+    std::mt19937 gen(seed);
+    Nodes nodes;
+    std::copy_if(map.grid.begin(), map.grid.end(), std::back_inserter(nodes),
+            [](const NodePtr& node) { return node->state < Node::NO_PARKING; });
+    // elevators appear once per floor in the grid
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    std::shuffle(nodes.begin(), nodes.end(), gen);
+    std::vector<size_t> bin_ids(map.bins.size());
+    std::iota(bin_ids.begin(), bin_ids.end(), 0);
+    std::shuffle(bin_ids.begin(), bin_ids.end(), gen);
+    n_requests = std::min({n_requests, bin_ids.size(), nodes.size()});
+    std::vector<BinRouter::BinRequest> requests;
+    requests.reserve(n_requests);
+    for (size_t i = 0; i < n_requests; ++i) {
+        auto& attributes = MapGen::attributes(nodes[i]);
+        requests.push_back({bin_ids[i], attributes.col, attributes.row, attributes.floor});
+    }
+    return requests;
+}
+
+BatchRunner::Scenario BatchRunner::defaultScenario() {
+    Scenario scenario;
+    auto& config = scenario.config;
+    config.elevator_duration = 10.0f;
+    config.fallback_cost = 5000;
+    config.blocking_fallback_cost = 10.0f;
+    config.iterations = 100000;
+    config.planner_config.rounds = 1000;
+    config.planner_config.n_threads = 1;
+    config.planner_config.allow_indefinite_block = false;
+    config.map_gen_config.rows = 10;
+    config.map_gen_config.cols = 10;
+    config.map_gen_config.floors = 1;
+    config.map_gen_config.n_bins = 10;
+    config.map_gen_config.n_bots = 2;
+    config.map_gen_config.seed = 0;
+    return scenario;
+}
+
+BatchRunner::BatchRunner(Config config)
+        : _config(std::move(config)) {
+    if (!_config.n_threads) {
+        _config.n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+BatchRunner::Error BatchRunner::loadScenarios(const char* file, size_t* error_line) {
+    std::ifstream input(file);
+    if (!input) {
+        return FILE_OPEN_FAIL;
+    }
+    return parseScenarios(input, error_line);
+}
+
+// parses value and checks that all of it was consumed
+template <class T>
+static bool parseValue(const std::string& str, T& value) {
+    std::istringstream stream(str);
+    return stream >> value && stream.peek() == EOF;
+}
+
+// parses a delimited list such as 1:2,3:4 into values
+template <class T>
+static bool parseList(std::string str, const char* delimiters, std::vector<T>& values) {
+    std::replace_if(
+            str.begin(), str.end(), [delimiters](char c) { return strchr(delimiters, c); }, ' ');
+    std::istringstream stream(str);
+    T value;
+    while (stream >> value) {
+        values.push_back(value);
+    }
+    return stream.eof() && !values.empty();
+}
+
+static bool parseKey(BatchRunner::Scenario& scenario, const std::string& key,
+        const std::string& value) {
+    auto& config = scenario.config;
+    auto& map_config = config.map_gen_config;
+    if (key == "name") {
+        scenario.name = value;
+    } else if (key == "output") {
+        scenario.output_file = value;
+    } else if (key == "snapshot") {
+        scenario.snapshot_file = value;
+    } else if (key == "rows") {
+        return parseValue(value, map_config.rows) && map_config.rows;
+    } else if (key == "cols") {
+        return parseValue(value, map_config.cols) && map_config.cols;
+    } else if (key == "floors") {
+        return parseValue(value, map_config.floors) && map_config.floors;
+    } else if (key == "bins") {
+        return parseValue(value, map_config.n_bins);
+    } else if (key == "bots") {
+        return parseValue(value, map_config.n_bots);
+    } else if (key == "seed") {
+        uint32_t seed;
+        if (!parseValue(value, seed)) {
+            return false;
+        }
+        map_config.seed = seed;
+    } else if (key == "elevators") {
+        std::vector<size_t> coords;
+        if (!parseList(value, ":,", coords) || coords.size() % 2) {
+            return false;
+        }
+        map_config.elevators.clear();
+        for (size_t i = 0; i < coords.size(); i += 2) {
+            map_config.elevators.emplace_back(coords[i], coords[i + 1]);
+        }
+    } else if (key == "request") {
+        std::vector<size_t> fields;
+        if (!parseList(value, ":", fields) || fields.size() != 4) {
+            return false;
+        }
+        scenario.requests.push_back({fields[0], fields[1], fields[2], fields[3]});
+    } else if (key == "requests") {
+        return parseValue(value, scenario.n_random_requests);
+    } else if (key == "request_seed") {
+        return parseValue(value, scenario.request_seed);
+    } else if (key == "elevator_duration") {
+        return parseValue(value, config.elevator_duration);
+    } else if (key == "fallback_cost") {
+        return parseValue(value, config.fallback_cost);
+    } else if (key == "blocking_fallback_cost") {
+        return parseValue(value, config.blocking_fallback_cost);
+    } else if (key == "iterations") {
+        return parseValue(value, config.iterations);
+    } else if (key == "rounds") {
+        return parseValue(value, config.planner_config.rounds);
+    } else if (key == "threads") {
+        return parseValue(value, config.planner_config.n_threads) &&
+               config.planner_config.n_threads;
+    } else if (key == "commit_batch") {
+        return parseValue(value, config.planner_config.commit_batch);
+    } else if (key == "time_limit") {
+        return parseValue(value, config.time_limit);
+    } else if (key == "pipelined") {
+        return parseValue(value, config.pipelined);
+    } else if (key == "partition_floors") {
+        return parseValue(value, config.partition_floors);
+    } else if (key == "elevator_heuristic") {
+        return parseValue(value, config.elevator_heuristic);
+    } else if (key == "assignment_candidates") {
+        return parseValue(value, config.assignment_candidates);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+BatchRunner::Error BatchRunner::parseScenarios(std::istream& input, size_t* error_line) {
+    // scenarios are only added if every line is valid
+    std::vector<Scenario> scenarios;
+    std::string line;
+    for (size_t line_number = 1; std::getline(input, line); ++line_number) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string token;
+        auto scenario = defaultScenario();
+        bool empty = true;
+        bool valid = true;
+        while (valid && tokens >> token) {
+            empty = false;
+            size_t split = token.find('=');
+            valid = split != std::string::npos &&
+                    parseKey(scenario, token.substr(0, split), token.substr(split + 1));
+        }
+        // elevators are checked once the map size set anywhere on the line is known
+        auto& map_config = scenario.config.map_gen_config;
+        valid = valid && std::all_of(map_config.elevators.begin(), map_config.elevators.end(),
+                                 [&map_config](const std::pair<size_t, size_t>& elevator) {
+                                     return elevator.first < map_config.cols &&
+                                            elevator.second < map_config.rows;
+                                 });
+        if (!valid) {
+            if (error_line) {
+                *error_line = line_number;
+            }
+            return SCENARIO_PARSE_FAIL;
+        }
+        if (empty) {
+            continue;
+        }
+        if (scenario.name.empty()) {
+            scenario.name = std::to_string(_scenarios.size() + scenarios.size());
+        }
+        scenarios.push_back(std::move(scenario));
+    }
+    _scenarios.insert(_scenarios.end(), std::make_move_iterator(scenarios.begin()),
+            std::make_move_iterator(scenarios.end()));
+    return SUCCESS;
+}
+
+const std::vector<BatchRunner::Result>& BatchRunner::run() {
+    // fit the widest scenario into the thread budget, more scenarios beat more planner
+    // threads since planner threads stall on each other's commits
+    size_t max_threads = 1;
+    for (auto& scenario : _scenarios) {
+        max_threads = std::max(max_threads, scenario.config.planner_config.n_threads);
+    }
+    _n_parallel = _config.n_parallel ? _config.n_parallel
+                                     : std::max<size_t>(1, _config.n_threads / max_threads);
+    _n_parallel = std::min(_n_parallel, std::max<size_t>(1, _scenarios.size()));
+    size_t thread_budget = std::max<size_t>(1, _config.n_threads / _n_parallel);
+
+    // the calling thread solves scenarios too
+    _results.clear();
+    _results.resize(_scenarios.size());
+    ThreadPool thread_pool(_n_parallel - 1);
+    thread_pool.run(_scenarios.size(), [&](size_t i) {
+        auto& scenario = _scenarios[i];
+        size_t n_threads = std::min(scenario.config.planner_config.n_threads, thread_budget);
+        _results[i] = runScenario(scenario, std::max<size_t>(1, n_threads));
+    });
+    return _results;
+}
+
+BatchRunner::Result BatchRunner::runScenario(const Scenario& scenario, size_t n_threads) const {
+    using Clock = std::chrono::steady_clock;
+    Result result{scenario.name, BinRouter::SUCCESS, n_threads, 0, 0, {}};
+    auto config = scenario.config;
+    config.planner_config.n_threads = n_threads;
+
+    auto start = Clock::now();
+    std::unique_ptr<BinRouter> router;
+    if (scenario.snapshot_file.empty()) {
+        router = std::make_unique<BinRouter>(std::move(config));
+    } else {
+        MapSnapshot snapshot(scenario.snapshot_file.c_str());
+        if (!snapshot.good()) {
+            result.error = BinRouter::FILE_OPEN_FAIL;
+            return result;
+        }
+        router = std::make_unique<BinRouter>(std::move(config), snapshot);
+    }
+    auto& bin_router = *router;
+    auto requests = scenario.requests;
+    auto random_requests = generateRequests(
+            bin_router.getMap(), scenario.n_random_requests, scenario.request_seed);
+    requests.insert(requests.end(), random_requests.begin(), random_requests.end());
+    auto solve_start = Clock::now();
+    result.map_gen_time = std::chrono::duration<double>(solve_start - start).count();
+
+    if (scenario.output_file.empty()) {
+        NullSink sink;
+        result.error = bin_router.solve(requests, sink);
+    } else {
+        result.error = bin_router.solve(requests, scenario.output_file.c_str());
+    }
+    result.solve_time = std::chrono::duration<double>(Clock::now() - solve_start).count();
+    result.stats = bin_router.getStats();
+    return result;
+}
+
+BatchRunner::Error BatchRunner::saveResults(const char* file) const {
+    FILE* fp = fopen(file, "w");
+    if (!fp) {
+        return FILE_OPEN_FAIL;
+    }
+    fputs("name,error,threads,map_gen_ms,solve_ms,bin_plan_ms,robot_plan_ms,stages,bin_layers,"
+          "bin_passes,bin_replans,robot_replans,makespan,travel_time,wait_time,max_wait_time,"
+          "elevator_rides,elevator_wait_time\n",
+            fp);
+    for (auto& result : _results) {
+        auto& stats = result.stats;
+        auto& metrics = stats.robot_metrics;
+        float max_wait_time = 0;
+        for (auto& agent : metrics.agents) {
+            max_wait_time = std::max(max_wait_time, agent.wait_time);
+        }
+        fprintf(fp,
+                "%s,%d,%zu,%.3f,%.3f,%.3f,%.3f,%zu,%zu,%zu,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%zu,%.3f\n",
+                result.name.c_str(), result.error, result.n_threads, result.map_gen_time * 1e3,
+                result.solve_time * 1e3, stats.bin_plan_time * 1e3, stats.robot_plan_time * 1e3,
+                stats.stages.size(), stats.bin_layers, stats.bin_passes, stats.bin_replans,
+                stats.robot_replans, metrics.makespan, metrics.travel_time, metrics.wait_time,
+                max_wait_time, metrics.elevator_rides, metrics.elevator_wait_time);
+    }
+    return fclose(fp) == 0 ? SUCCESS : FILE_OPEN_FAIL;
+}
+
+}  // namespace swarm_sim
@@ -0,0 +1,45 @@
+#include <swarm_sim/batch_runner.hpp>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace swarm_sim;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s SCENARIO_FILE RESULT_FILE [THREADS] [PARALLEL]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    BatchRunner::Config config;
+    config.n_threads = argc > 3 ? strtoul(argv[3], nullptr, 10) : 0;
+    config.n_parallel = argc > 4 ? strtoul(argv[4], nullptr, 10) : 0;
+    BatchRunner batch_runner(config);
+
+    size_t error_line = 0;
+    switch (batch_runner.loadScenarios(argv[1], &error_line)) {
+        case BatchRunner::SUCCESS:
+            break;
+        case BatchRunner::SCENARIO_PARSE_FAIL:
+            fprintf(stderr, "%s:%zu: invalid scenario\n", argv[1], error_line);
+            return EXIT_FAILURE;
+        default:
+            fprintf(stderr, "failed to open %s\n", argv[1]);
+            return EXIT_FAILURE;
+    }
+
+    auto& results = batch_runner.run();
+    size_t n_failed = 0;
+    for (auto& result : results) {
+        if (result.error) {
+            fprintf(stderr, "scenario %s failed with error %d\n", result.name.c_str(),
+                    result.error);
+            ++n_failed;
+        }
+    }
+    printf("solved %zu of %zu scenarios with %zu in parallel\n", results.size() - n_failed,
+            results.size(), batch_runner.getParallelism());
+    if (batch_runner.saveResults(argv[2])) {
+        fprintf(stderr, "failed to write %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,34 @@
+#include <swarm_sim/bin_request_queue.hpp>
+
+namespace swarm_sim {
+
+void BinRequestQueue::push(const BinRouter::BinRequest& request) {
+    std::lock_guard lock(_mutex);
+    if (!_closed) {
+        _entries.push_back({request, Clock::now()});
+    }
+}
+
+void BinRequestQueue::close() {
+    {
+        std::lock_guard lock(_mutex);
+        _closed = true;
+    }
+    _closed_cv.notify_all();
+}
+
+bool BinRequestQueue::drain(Clock::time_point deadline, std::vector<Entry>& entries) {
+    std::unique_lock lock(_mutex);
+    // requests are collected until the horizon, only closing ends the wait early
+    _closed_cv.wait_until(lock, deadline, [this] { return _closed; });
+    entries.assign(_entries.begin(), _entries.end());
+    _entries.clear();
+    return !_closed;
+}
+
+size_t BinRequestQueue::size() const {
+    std::lock_guard lock(_mutex);
+    return _entries.size();
+}
+
+}  // namespace swarm_sim
@@ -1,149 +1,480 @@
 #include <swarm_sim/bin_router.hpp>
+#include <swarm_sim/bin_request_queue.hpp>
+#include <swarm_sim/map_snapshot.hpp>
+#include <swarm_sim/assignment.hpp>
 #include <algorithm>
+#include <numeric>
 
 namespace swarm_sim {
 
+static MapGen::Config emptyMapConfig(MapGen::Config map_config) {
+    map_config.n_bins = 0;
+    map_config.n_bots = 0;
+    return map_config;
+}
+
+static size_t countDeferred(const MultiPathPlanner& planner) {
+    auto& results = planner.getResults();
+    return std::count_if(results.begin(), results.end(),
+            [](const MultiPathPlanner::Result& result) { return result.deferred; });
+}
+
 BinRouter::BinRouter(Config config)
         : _config(std::move(config))
-        , _map(_config.map_gen_config) {}
+        , _map(_config.map_gen_config) {
+    // pipelined mode plans and saves alternating stages on two robot graphs
+    size_t n_buffers = _config.pipelined ? 2 : 1;
+    _robot_maps.reserve(n_buffers);
+    for (size_t i = 0; i < n_buffers; ++i) {
+        _robot_maps.emplace_back(emptyMapConfig(_config.map_gen_config));
+    }
+    initThreadPool();
+}
+
+BinRouter::BinRouter(Config config, const MapSnapshot& snapshot)
+        : _config(std::move(config))
+        , _map(snapshot) {
+    size_t n_buffers = _config.pipelined ? 2 : 1;
+    _robot_maps.reserve(n_buffers);
+    for (size_t i = 0; i < n_buffers; ++i) {
+        _robot_maps.emplace_back(snapshot, false);
+    }
+    initThreadPool();
+}
+
+void BinRouter::initThreadPool() {
+    // share one persistent worker pool between bin and robot planning stages
+    _thread_pool = std::make_shared<ThreadPool>(
+            _config.planner_config.n_threads, _config.planner_config.cpu_affinity);
+    _bin_path_planner.setThreadPool(_thread_pool);
+    for (auto& robot_path_planner : _robot_path_planners) {
+        robot_path_planner.setThreadPool(_thread_pool);
+    }
+}
 
 BinRouter::Error BinRouter::solve(const std::vector<BinRequest>& requests, const char* save_file) {
+    // write csv on a background thread
+    AsyncSink sink(std::make_unique<CsvSink>(save_file));
+    if (!sink.good()) {
+        return FILE_OPEN_FAIL;
+    }
+    return solve(requests, sink);
+}
+
+BinRouter::Error BinRouter::solve(const std::vector<BinRequest>& requests, OutputSink& sink) {
+    if (Error error = planBinPaths(requests)) {
+        return error;
+    }
+    return planStages(sink);
+}
+
+BinRouter::Error BinRouter::planBinPaths(const std::vector<BinRequest>& requests) {
+    _stats = {};
+    startTimeLimit();
+    // bins and bots start from their current positions
+    _bin_sources = _map.bins;
+    _bot_sources = _map.bots;
+
     // create and initialize bin destination vector
-    std::vector<Nodes> dst_vec;
-    dst_vec.reserve(_map.bins.size());
-    for (auto& src : _map.bins) {
-        dst_vec.emplace_back(Nodes{src});
+    _bin_destinations.clear();
+    _bin_destinations.reserve(_bin_sources.size());
+    for (auto& src : _bin_sources) {
+        _bin_destinations.emplace_back(Nodes{src});
     }
 
     // add bin requests to destination vector
     for (auto& req : requests) {
-        if (req.bin_id >= _map.bins.size()) {
-            return REQUEST_BIN_ID_OUT_OF_RANGE;
-        }
-        auto dst_node = _map.graph.findNode({static_cast<float>(req.col),
-                static_cast<float>(req.row), static_cast<float>(req.floor)});
-        if (!dst_node) {
-            return REQUEST_BIN_NODE_NOT_FOUND;
-        }
-        if (dst_node->state >= Node::NO_PARKING) {
-            return REQUEST_BIN_NODE_NOT_PARKABLE;
+        NodePtr dst_node;
+        if (Error error = validateRequest(req, dst_node)) {
+            return error;
         }
-        dst_vec[req.bin_id] = {dst_node};
+        _bin_destinations[req.bin_id] = {dst_node};
     }
 
-    // open save file
-    auto fp = fopen(save_file, "w");
-    if (!fp) {
-        return FILE_OPEN_FAIL;
+    // generate bin routes
+    return generateBinPaths();
+}
+
+BinRouter::Error BinRouter::addBinRequests(const std::vector<BinRequest>& requests) {
+    startTimeLimit();
+    std::vector<size_t> changed;
+    for (auto& req : requests) {
+        NodePtr dst_node;
+        if (Error error = validateRequest(req, dst_node)) {
+            return error;
+        }
+        _bin_destinations[req.bin_id] = {dst_node};
+        changed.push_back(req.bin_id);
     }
+    return generateBinPaths(&changed);
+}
 
-    // write static marker entries to data file
-    fprintf(fp, "stage, type, id, x, y, z, t\r\n");
+BinRouter::Error BinRouter::warmStartBinPaths(const std::vector<BinRequest>& requests) {
+    // nothing planned yet to start from
+    if (_bin_sources.size() != _map.bins.size()) {
+        return planBinPaths(requests);
+    }
+    _stats = {};
+    startTimeLimit();
+    std::vector<Nodes> destinations;
+    destinations.reserve(_map.bins.size());
+    for (auto& bin : _map.bins) {
+        destinations.emplace_back(Nodes{bin});
+    }
+    for (auto& req : requests) {
+        NodePtr dst_node;
+        if (Error error = validateRequest(req, dst_node)) {
+            return error;
+        }
+        destinations[req.bin_id] = {dst_node};
+    }
+    // bins that moved, were retargeted or were deferred last time need new paths
+    auto& results = _bin_path_planner.getResults();
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < _map.bins.size(); ++i) {
+        if (_map.bins[i] != _bin_sources[i] || destinations[i] != _bin_destinations[i] ||
+                results[i].deferred) {
+            changed.push_back(i);
+        }
+    }
+    _bin_sources = _map.bins;
+    _bot_sources = _map.bots;
+    _bin_destinations = std::move(destinations);
+    return generateBinPaths(&changed);
+}
 
-    // generate bin routes
-    if (Error error = generateBinPaths(dst_vec)) {
-        fclose(fp);
-        return error;
+BinRouter::Error BinRouter::cancelBinRequests(const std::vector<size_t>& bin_ids) {
+    startTimeLimit();
+    for (size_t bin_id : bin_ids) {
+        if (bin_id >= _bin_sources.size()) {
+            return REQUEST_BIN_ID_OUT_OF_RANGE;
+        }
+        // cancelled bins stay where they are
+        _bin_destinations[bin_id] = {_bin_sources[bin_id]};
     }
+    return generateBinPaths(&bin_ids);
+}
+
+BinRouter::Error BinRouter::planStages(OutputSink& sink) {
+    int stage = 0;
+    return planStages(sink, stage);
+}
 
+BinRouter::Error BinRouter::stream(BinRequestQueue& queue, OutputSink& sink, double horizon) {
+    using Clock = BinRequestQueue::Clock;
+    _stream_stats = {};
     int stage = 0;
-    saveEntities(fp, stage);
-    savePaths(_bin_path_planner.getPathSync(), fp, stage++, false);
-
-    // generate traversal order of bin routes
-    std::vector<int> order;
-    generateTraversalOrder(order, _bin_path_planner.getPathSync());
-
-    // generate bin paths by processing one chunk of the traversal at a time
-    for (auto cur = order.cbegin(); cur != order.cend();) {
-        auto bin_idx = cur;
-        saveEntities(fp, stage);
-        if (Error error = generateRobotPaths(cur, order.cend())) {
-            fclose(fp);
+    std::vector<BinRequestQueue::Entry> entries;
+    std::vector<BinRequestQueue::Entry> pending;
+    std::vector<BinRequest> requests;
+    auto horizon_duration =
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(horizon));
+    auto cycle_end = Clock::now();
+    bool open = true;
+    while (open || !pending.empty()) {
+        cycle_end += horizon_duration;
+        open = queue.drain(cycle_end, entries);
+        _stream_stats.queue_depths.push_back(entries.size());
+        for (auto& entry : entries) {
+            NodePtr dst_node;
+            if (validateRequest(entry.request, dst_node)) {
+                ++_stream_stats.rejected;
+                continue;
+            }
+            // a later request of a bin replaces its earlier one
+            auto found = std::find_if(pending.begin(), pending.end(), [&entry](const auto& p) {
+                return p.request.bin_id == entry.request.bin_id;
+            });
+            if (found != pending.end()) {
+                ++_stream_stats.rejected;
+                *found = entry;
+            } else {
+                pending.push_back(entry);
+            }
+        }
+        if (pending.empty()) {
+            continue;
+        }
+
+        // plan pending requests from where the bins are now
+        SWARM_SIM_TRACE_BEGIN("stream_cycle", _stream_stats.cycles, pending.size());
+        requests.clear();
+        for (auto& entry : pending) {
+            requests.push_back(entry.request);
+        }
+        Error error = warmStartBinPaths(requests);
+        if (!error) {
+            error = planStages(sink, stage);
+        }
+        if (error && error != TIME_LIMIT_REACHED) {
             return error;
         }
-        for (; bin_idx != cur; ++bin_idx) {
-            auto& bin_path =
-                    _bin_path_planner.getPathSync().getPaths().at(std::to_string(*bin_idx)).path;
-            savePath(*bin_idx + _map.bots.size(), bin_path, fp, stage, false);
+        ++_stream_stats.cycles;
+        SWARM_SIM_TRACE_END("stream_cycle", _stream_stats.cycles - 1, error);
+
+        // delivered requests report their latency, the others stay pending
+        auto now = Clock::now();
+        size_t n_pending = pending.size();
+        auto delivered = [&](const BinRequestQueue::Entry& entry) {
+            auto& req = entry.request;
+            if (_map.bins[req.bin_id] != _map.at(req.col, req.row, req.floor)) {
+                return false;
+            }
+            auto latency = std::chrono::duration<double>(now - entry.time);
+            _stream_stats.latencies.push_back(latency.count());
+            return true;
+        };
+        pending.erase(std::remove_if(pending.begin(), pending.end(), delivered), pending.end());
+        // a closed stream without progress would never finish
+        if (!open && pending.size() == n_pending) {
+            return error ? error : GENERATE_ROBOT_PATHS_FAIL;
         }
-        savePaths(_robot_path_planner.getPathSync(), fp, stage++, true);
     }
-
-    fclose(fp);
     return SUCCESS;
 }
 
-BinRouter::Error BinRouter::generateRobotPaths(std::vector<int>::const_iterator& order_cur,
-        const std::vector<int>::const_iterator order_end) {
-    // create new empty graph from config
-    MapGen::Config map_config = _config.map_gen_config;
-    map_config.n_bins = 0;
-    map_config.n_bots = 0;
-    MapGen robot_map(map_config);
+BinRouter::Error BinRouter::planStages(OutputSink& sink, int& stage) {
+    // restart from the positions the bin paths were planned from
+    _map.bins = _bin_sources;
+    _map.bots = _bot_sources;
+    _stats.robot_plan_time = 0;
+    _stats.robot_replans = 0;
+    _stats.robot_metrics = {};
+    _stats.stages.resize(std::min<size_t>(_stats.stages.size(), 1));
+
+    saveEntities(sink, stage, _map.bins, _map.bots);
+    savePaths(_bin_path_planner, sink, stage++, false);
+
+    // carry out bin paths once the bins they depend on have moved
+    DependencyGraph dependencies;
+    dependencies.build(_bin_path_planner);
+    _stats.bin_layers = dependencies.getLayerCount();
+    _stats.bin_passes = 1;
+
+    // each stage gives the available robots the ready bins of the lowest layers
+    // pipelined mode saves each stage while the next stage is planned on the other buffer
+    size_t n_buffers = _robot_maps.size();
+    StageOutput prev_output;
+    Error error = SUCCESS;
+    // save pending stage, only its entities if its planning failed
+    auto save_pending = [&]() {
+        if (prev_output.stage > 0) {
+            if (error) {
+                saveEntities(sink, prev_output.stage, prev_output.bins, prev_output.bots);
+            } else {
+                saveStage(sink, prev_output);
+            }
+            prev_output.stage = 0;
+        }
+    };
+    std::vector<size_t> candidates;
+    while (!error) {
+        if (dependencies.done()) {
+            // bins deferred by the bin planner are planned again from where the bins are now
+            size_t n_deferred = countDeferred(_bin_path_planner);
+            if (!n_deferred) {
+                break;
+            }
+            // pending stage output reads the current bin paths
+            save_pending();
+            if (std::chrono::steady_clock::now() >= _deadline) {
+                error = TIME_LIMIT_REACHED;
+                break;
+            }
+            if ((error = replanDeferredBins())) {
+                break;
+            }
+            dependencies.build(_bin_path_planner);
+            _stats.bin_layers += dependencies.getLayerCount();
+            ++_stats.bin_passes;
+            // none of the deferred bins could be planned in this pass
+            if (countDeferred(_bin_path_planner) >= n_deferred) {
+                error = std::chrono::steady_clock::now() >= _deadline ? TIME_LIMIT_REACHED
+                                                                      : GENERATE_BIN_PATHS_FAIL;
+            }
+            continue;
+        }
+        // snapshot entities before the stage moves them
+        StageOutput output{stage, _map.bins, _map.bots, {}, stage % n_buffers};
+        auto plan_stage = [&]() {
+            SWARM_SIM_TRACE_BEGIN("stage", stage);
+            dependencies.takeReady(_map.bots.size(), candidates);
+            error = generateRobotPaths(candidates, output.bin_ids, output.buffer);
+            // bins not picked up by any robot wait for the next stage
+            for (size_t bin_id : candidates) {
+                bool moved = std::find(output.bin_ids.begin(), output.bin_ids.end(), bin_id) !=
+                             output.bin_ids.end();
+                moved ? dependencies.complete(bin_id) : dependencies.retry(bin_id);
+            }
+            if (!error && output.bin_ids.empty()) {
+                error = std::chrono::steady_clock::now() >= _deadline ? TIME_LIMIT_REACHED
+                                                                      : GENERATE_ROBOT_PATHS_FAIL;
+            }
+            SWARM_SIM_TRACE_END("stage", stage, error);
+        };
+        if (n_buffers > 1) {
+            // save previous stage while this one is planned
+            _thread_pool->run(prev_output.stage > 0 ? 2 : 1, [&](size_t task) {
+                task ? saveStage(sink, prev_output) : plan_stage();
+            });
+            prev_output = std::move(output);
+        } else {
+            plan_stage();
+            prev_output = std::move(output);
+            if (!error) {
+                save_pending();
+            }
+        }
+        ++stage;
+    }
+    save_pending();
+
+    sink.flush();
+    return error;
+}
+
+BinRouter::Error BinRouter::replanDeferredBins() {
+    // bins that are not deferred stay where they are, deferred bins keep their destinations
+    auto& results = _bin_path_planner.getResults();
+    for (size_t i = 0; i < _bin_destinations.size(); ++i) {
+        if (!results[i].deferred) {
+            _bin_destinations[i] = {_map.bins[i]};
+        }
+    }
+    _bin_sources = _map.bins;
+    _bot_sources = _map.bots;
+    // record the pass after the stages planned so far
+    auto stages = std::move(_stats.stages);
+    Error error = generateBinPaths();
+    stages.push_back(std::move(_stats.stages[0]));
+    _stats.stages = std::move(stages);
+    return error;
+}
+
+void BinRouter::startTimeLimit() {
+    _deadline = std::chrono::steady_clock::time_point::max();
+    if (_config.time_limit > 0) {
+        _deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(_config.time_limit));
+    }
+}
+
+MultiPathPlanner::Config BinRouter::plannerConfig() const {
+    auto config = _config.planner_config;
+    config.deadline = std::min(config.deadline, _deadline);
+    return config;
+}
 
+BinRouter::Error BinRouter::validateRequest(const BinRequest& request, NodePtr& dst_node) const {
+    if (request.bin_id >= _map.bins.size()) {
+        return REQUEST_BIN_ID_OUT_OF_RANGE;
+    }
+    dst_node = _map.at(request.col, request.row, request.floor);
+    if (!dst_node) {
+        return REQUEST_BIN_NODE_NOT_FOUND;
+    }
+    if (dst_node->state >= Node::NO_PARKING) {
+        return REQUEST_BIN_NODE_NOT_PARKABLE;
+    }
+    return SUCCESS;
+}
+
+BinRouter::Error BinRouter::generateRobotPaths(
+        const std::vector<size_t>& bin_ids, std::vector<size_t>& moved_bin_ids, size_t buffer) {
+    // the robot graph is reused across stages, bids of the previous stage
+    // are released from its auctions when the planner clears its paths
+    auto& robot_map = _robot_maps[buffer];
+    auto& robot_path_planner = _robot_path_planners[buffer];
     // create path search config
     PathSearch::Config path_search_config;
-    path_search_config.travel_time = [this](const NodePtr& prev, const NodePtr& cur,
-                                             const NodePtr& next) {
-        return customTravelTime(prev, cur, next);
-    };
+    path_search_config.travel_time = WarehouseTravelTime{
+            _config.elevator_duration, _config.elevator_heuristic ? &robot_map : nullptr};
 
     // build destination candidates vector
     Nodes dst_candidates;
-    std::unordered_map<NodePtr, std::pair<int, NodePtr>> dst_map;
-    for (const auto order_begin = order_cur;
-            order_cur != order_begin + _map.bots.size() && order_cur != order_end; ++order_cur) {
-        printf("%d, ", *order_cur);
-        auto& bin_path =
-                _bin_path_planner.getPathSync().getPaths().at(std::to_string(*order_cur)).path;
+    std::unordered_map<NodePtr, std::pair<size_t, NodePtr>> dst_map;
+    for (size_t bin_id : bin_ids) {
+        auto& bin_path = _bin_path_planner.getAgentIndex().getPath(bin_id);
         auto bin_position = bin_path.front().node->position;
-        auto bin_node = robot_map.graph.findNode(bin_position);
+        auto bin_node = robot_map.find(bin_position);
         assert(bin_node);
         dst_candidates.emplace_back(bin_node);
-        dst_map.emplace(bin_node, std::pair<int, NodePtr>{*order_cur, bin_path.back().node});
+        dst_map.emplace(bin_node, std::pair<size_t, NodePtr>{bin_id, bin_path.back().node});
+    }
+    moved_bin_ids.clear();
+
+    Nodes robot_locs;
+    for (auto& bot : _map.bots) {
+        robot_locs.emplace_back(robot_map.find(bot->position));
+        assert(robot_locs.back());
+    }
+    // optionally assign bins to robots up front instead of having every robot bid on every bin
+    std::vector<Nodes> assigned_dsts;
+    if (_config.assignment_candidates) {
+        assignBins(robot_map, robot_locs, dst_candidates, assigned_dsts);
     }
-    puts("end");
 
-    // build robot path requests
+    // build robot path requests, robots bidding on every bin share one destination set
     _path_requests.clear();
+    auto shared_dst = std::make_shared<const Nodes>(std::move(dst_candidates));
     for (size_t i = 0; i < _map.bots.size(); ++i) {
-        NodePtr robot_loc = robot_map.graph.findNode(_map.bots[i]->position);
-        assert(robot_loc);
+        NodePtr robot_loc = robot_locs[i];
         path_search_config.agent_id = std::to_string(i);
         float fallback_cost = _config.fallback_cost;
-        // need to lower fallback costs and increase price increment when there are less
-        // destinations than robots otherwise they keep competing until out of iterations
-        if (dst_candidates.size() < _map.bots.size()) {
+        auto dst = shared_dst;
+        if (_config.assignment_candidates) {
+            // robots without a bin only move out of the way
+            if (assigned_dsts[i].empty()) {
+                dst = std::make_shared<const Nodes>(Nodes{robot_loc});
+                fallback_cost = _config.blocking_fallback_cost;
+            } else {
+                dst = std::make_shared<const Nodes>(std::move(assigned_dsts[i]));
+            }
+        } else if (shared_dst->size() < _map.bots.size()) {
+            // need to lower fallback costs and increase price increment when there are less
+            // destinations than robots otherwise they keep competing until out of iterations
             fallback_cost /= 5;
             path_search_config.price_increment *= 10;
         }
-        MultiPathPlanner::Request request{dst_candidates, FLT_MAX, path_search_config,
+        MultiPathPlanner::Request request{std::move(dst), FLT_MAX, path_search_config,
                 {{robot_loc}, _config.iterations, fallback_cost}};
         _path_requests.emplace_back(std::move(request));
     }
 
     // plan robot routes
-    _robot_path_planner.plan(_config.planner_config, _path_requests);
+    robot_path_planner.plan(plannerConfig(), _path_requests);
+    _stats.robot_plan_time += robot_path_planner.getStats().wall_time;
+    _stats.robot_replans += robot_path_planner.getStats().commits;
+    recordStage(robot_path_planner, robot_map);
 
-    auto& path_sync = _robot_path_planner.getPathSync();
-    auto& results = _robot_path_planner.getResults();
+    auto& agent_index = robot_path_planner.getAgentIndex();
+    auto& results = robot_path_planner.getResults();
     for (size_t i = 0; i < results.size(); ++i) {
         // skip bins that don't move
-        auto& path = path_sync.getPaths().at(std::to_string(i)).path;
-        printf("robot id %ld search %d sync %d length %ld\n", i, results[i].search_error,
-                results[i].sync_error, path.size());
-        // return GENERATE_ROBOT_PATHS_FAIL;
+        auto& path = agent_index.getPath(i);
+        SWARM_SIM_TRACE_INSTANT("robot_result", i, results[i].search_error);
+        // deferred robots stay where they are, their bins are offered again next stage
+        if (results[i].deferred) {
+            continue;
+        }
+        if (results[i].sync_error) {
+            SWARM_SIM_TRACE_INSTANT("robot_sync_error", i, results[i].sync_error);
+        }
         if (results[i].search_error > PathSearch::FALLBACK_DIVERTED || results[i].sync_error) {
             return GENERATE_ROBOT_PATHS_FAIL;
         }
         // move bin and robot to destination of bin
-        if (results[i].search_error == PathSearch::SUCCESS) {
-            auto [bin_id, bin_dst_node] = dst_map.at(path.back().node);
+        auto found = results[i].search_error == PathSearch::SUCCESS ? dst_map.find(path.back().node)
+                                                                    : dst_map.end();
+        if (found != dst_map.end()) {
+            auto [bin_id, bin_dst_node] = found->second;
             _map.bots[i] = bin_dst_node;
             _map.bins[bin_id] = bin_dst_node;
-        } else if (results[i].search_error == PathSearch::FALLBACK_DIVERTED) {
-            auto dst_node = _map.graph.findNode(path.back().node->position);
+            moved_bin_ids.push_back(bin_id);
+        } else if (!path.empty()) {
+            // diverted or unassigned robots end up at the end of their path
+            auto dst_node = _map.find(path.back().node->position);
             assert(dst_node);
             _map.bots[i] = dst_node;
         }
@@ -151,16 +482,48 @@ BinRouter::Error BinRouter::generateRobotPaths(std::vector<int>::const_iterator&
     return SUCCESS;
 }
 
-BinRouter::Error BinRouter::generateBinPaths(const std::vector<Nodes>& dst_vec) {
-    auto& src_vec = _map.bins;
+void BinRouter::assignBins(const MapGen& robot_map, const Nodes& robot_locs,
+        const Nodes& bin_locs, std::vector<Nodes>& assigned_dsts) const {
+    // estimate travel times without planning
+    WarehouseTravelTime estimate{_config.elevator_duration, &robot_map};
+    size_t n_bots = robot_locs.size();
+    size_t n_bins = bin_locs.size();
+    std::vector<float> costs(n_bots * n_bins);
+    for (size_t i = 0; i < n_bots; ++i) {
+        for (size_t j = 0; j < n_bins; ++j) {
+            costs[i * n_bins + j] = estimate(nullptr, robot_locs[i], bin_locs[j]);
+        }
+    }
+    auto assignment = solveAssignment(costs, n_bots, n_bins);
+
+    // assigned bin followed by the next closest bins as fallback candidates
+    assigned_dsts.assign(n_bots, {});
+    std::vector<size_t> ranked(n_bins);
+    for (size_t i = 0; i < n_bots; ++i) {
+        if (assignment[i] == NOT_ASSIGNED) {
+            continue;
+        }
+        std::iota(ranked.begin(), ranked.end(), 0);
+        std::swap(ranked[0], ranked[assignment[i]]);
+        size_t n_candidates = std::min(_config.assignment_candidates, n_bins);
+        auto row = costs.begin() + i * n_bins;
+        std::partial_sort(ranked.begin() + 1, ranked.begin() + n_candidates, ranked.end(),
+                [&row](size_t a, size_t b) { return row[a] < row[b]; });
+        for (size_t j = 0; j < n_candidates; ++j) {
+            assigned_dsts[i].push_back(bin_locs[ranked[j]]);
+        }
+    }
+}
+
+BinRouter::Error BinRouter::generateBinPaths(const std::vector<size_t>* changed) {
+    auto& src_vec = _bin_sources;
+    auto& dst_vec = _bin_destinations;
     assert(src_vec.size() == dst_vec.size());
     _path_requests.clear();
     // create path search config
     PathSearch::Config path_search_config;
-    path_search_config.travel_time = [this](const NodePtr& prev, const NodePtr& cur,
-                                             const NodePtr& next) {
-        return customTravelTime(prev, cur, next);
-    };
+    path_search_config.travel_time = WarehouseTravelTime{
+            _config.elevator_duration, _config.elevator_heuristic ? &_map : nullptr};
 
     // create requests vector
     for (size_t i = 0; i < src_vec.size(); ++i) {
@@ -169,22 +532,42 @@ BinRouter::Error BinRouter::generateBinPaths(const std::vector<Nodes>& dst_vec)
         float fallback_cost = dst.size() == 1 && dst.front() == src ? _config.blocking_fallback_cost
                                                                     : _config.fallback_cost;
         path_search_config.agent_id = std::to_string(i);
-        MultiPathPlanner::Request request{
-                dst, FLT_MAX, path_search_config, {{src}, _config.iterations, fallback_cost}};
+        MultiPathPlanner::Request request{std::make_shared<const Nodes>(dst), FLT_MAX,
+                path_search_config, {{src}, _config.iterations, fallback_cost}};
         _path_requests.emplace_back(std::move(request));
     }
-    // plan routes
-    _bin_path_planner.plan(_config.planner_config, _path_requests);
-    auto& path_sync = _bin_path_planner.getPathSync();
+    // plan routes from scratch or warm start from the previous bin paths
+    SWARM_SIM_TRACE_BEGIN("bin_plan", changed ? changed->size() : _path_requests.size());
+    if (changed) {
+        _bin_path_planner.replan(plannerConfig(), _path_requests, *changed);
+    } else if (_config.partition_floors && _map.floors > 1) {
+        generatePartitionedBinPaths();
+    } else {
+        _bin_path_planner.plan(plannerConfig(), _path_requests);
+    }
+    SWARM_SIM_TRACE_END("bin_plan");
+    _stats.bin_plan_time += _bin_path_planner.getStats().wall_time;
+    _stats.bin_replans += _bin_path_planner.getStats().commits;
+    // bin planning is always the first stage
+    _stats.stages.resize(1);
+    _stats.stages[0] = {_bin_path_planner.getStats(), _bin_path_planner.getResults(),
+            Evaluator(_map, _config.elevator_duration).evaluate(_bin_path_planner)};
+    auto& agent_index = _bin_path_planner.getAgentIndex();
     auto& results = _bin_path_planner.getResults();
     for (size_t i = 0; i < results.size(); ++i) {
         // skip bins that don't move
-        size_t len = path_sync.getPaths().at(std::to_string(i)).path.size();
+        size_t len = agent_index.getPath(i).size();
         if ((dst_vec[i].empty() || dst_vec[i].front() == src_vec[i]) && len < 2) {
             continue;
         }
-        printf("id %ld search %d sync %d length %ld\n", i, results[i].search_error,
-                results[i].sync_error, len);
+        SWARM_SIM_TRACE_INSTANT("bin_result", i, results[i].search_error);
+        // deferred bins stay put and are planned again in a later pass
+        if (results[i].deferred) {
+            continue;
+        }
+        if (results[i].sync_error) {
+            SWARM_SIM_TRACE_INSTANT("bin_sync_error", i, results[i].sync_error);
+        }
         if (results[i].search_error > PathSearch::FALLBACK_DIVERTED || results[i].sync_error) {
             return GENERATE_BIN_PATHS_FAIL;
         }
@@ -192,37 +575,112 @@ BinRouter::Error BinRouter::generateBinPaths(const std::vector<Nodes>& dst_vec)
     return SUCCESS;
 }
 
-void BinRouter::saveEntities(FILE* save_file, int stage) {
-    assert(save_file);
-    int id = 0;
-    for (auto& ele : _map.elevators) {
-        fprintf(save_file, "%d, %u, %u, %f, %f, %f, %d\r\n", stage, ELEVATOR, id++,
-                ele->position.get<0>(), ele->position.get<1>(), ele->position.get<2>(), 0);
+void BinRouter::generatePartitionedBinPaths() {
+    auto start = std::chrono::steady_clock::now();
+    // split bins by floor, bins with any destination off their floor are coordinated later
+    std::vector<std::vector<size_t>> floor_agents(_map.floors);
+    // floor planners keep pointing at their requests, so they live next to the planners
+    auto& floor_requests = _floor_path_requests;
+    floor_requests.resize(_map.floors);
+    for (auto& requests : floor_requests) {
+        requests.clear();
     }
-    id = 0;
-    for (auto& bin : _map.bins) {
-        fprintf(save_file, "%d, %u, %u, %f, %f, %f, %d\r\n", stage, BIN, id++,
-                bin->position.get<0>(), bin->position.get<1>(), bin->position.get<2>(), 0);
+    std::vector<size_t> cross_floor_agents;
+    for (size_t i = 0; i < _path_requests.size(); ++i) {
+        float floor = _bin_sources[i]->position.get<2>();
+        auto& dst = _bin_destinations[i];
+        if (dst.empty() || std::any_of(dst.begin(), dst.end(), [floor](const NodePtr& node) {
+                return node->position.get<2>() != floor;
+            })) {
+            cross_floor_agents.push_back(i);
+            continue;
+        }
+        floor_agents[static_cast<size_t>(floor)].push_back(i);
+        floor_requests[static_cast<size_t>(floor)].push_back(_path_requests[i]);
     }
-    id = 0;
-    for (auto& bot : _map.bots) {
-        fprintf(save_file, "%d, %u, %u, %f, %f, %f, %d\r\n", stage, ROBOT, id++,
-                bot->position.get<0>(), bot->position.get<1>(), bot->position.get<2>(), 0);
+    while (_floor_path_planners.size() < _map.floors) {
+        _floor_path_planners.emplace_back(_thread_pool);
+    }
+    // floors only connect through elevators, disabling them keeps the partitions independent
+    std::vector<Node::State> elevator_states;
+    for (auto& elevator : _map.elevators) {
+        elevator_states.push_back(elevator->state);
+        elevator->state = Node::DISABLED;
+    }
+    auto floor_config = plannerConfig();
+    floor_config.n_threads = std::max<size_t>(1, floor_config.n_threads / _map.floors);
+    _thread_pool->run(_map.floors, [&](size_t floor) {
+        if (!floor_requests[floor].empty()) {
+            SWARM_SIM_TRACE_BEGIN("floor_plan", floor, floor_requests[floor].size());
+            _floor_path_planners[floor].plan(floor_config, floor_requests[floor]);
+            SWARM_SIM_TRACE_END("floor_plan", floor);
+        }
+    });
+    for (size_t i = 0; i < _map.elevators.size(); ++i) {
+        _map.elevators[i]->state = elevator_states[i];
+    }
+    for (auto& floor_planner : _floor_path_planners) {
+        _stats.bin_replans += floor_planner.getStats().commits;
+    }
+    _stats.bin_plan_time +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // merge floor paths and plan the cross floor bins, along with any bins they disturb
+    auto config = plannerConfig();
+    _bin_path_planner.initialize(_path_requests, config.count_iterations);
+    for (size_t floor = 0; floor < _map.floors; ++floor) {
+        if (!floor_requests[floor].empty()) {
+            _bin_path_planner.importPaths(
+                    config, _floor_path_planners[floor], floor_agents[floor]);
+        }
     }
+    _bin_path_planner.replan(config, _path_requests, cross_floor_agents);
 }
 
-void BinRouter::savePath(int id, const Path& path, FILE* save_file, int stage, bool under) {
+void BinRouter::recordStage(const MultiPathPlanner& planner, const MapGen& robot_map) {
+    auto metrics = Evaluator(robot_map, _config.elevator_duration).evaluate(planner);
+    _stats.robot_metrics.append(metrics);
+    _stats.stages.push_back({planner.getStats(), planner.getResults(), std::move(metrics)});
+}
+
+void BinRouter::saveStage(OutputSink& sink, const StageOutput& output) {
+    SWARM_SIM_TRACE_BEGIN("save_stage", output.stage);
+    saveEntities(sink, output.stage, output.bins, output.bots);
+    for (size_t bin_id : output.bin_ids) {
+        auto& bin_path = _bin_path_planner.getAgentIndex().getPath(bin_id);
+        savePath(bin_id + output.bots.size(), bin_path, sink, output.stage, false);
+    }
+    savePaths(_robot_path_planners[output.buffer], sink, output.stage, true);
+    SWARM_SIM_TRACE_END("save_stage", output.stage);
+}
+
+void BinRouter::saveEntities(
+        OutputSink& sink, int stage, const Nodes& bins, const Nodes& bots) {
+    // lambda to save entity entries of one type
+    auto save_entities = [&](const Nodes& nodes, DataEntryType type) {
+        int id = 0;
+        for (auto& node : nodes) {
+            sink.writeEntity({stage, type, id++, node->position.get<0>(),
+                    node->position.get<1>(), node->position.get<2>(), 0});
+        }
+    };
+    save_entities(_map.elevators, ELEVATOR);
+    save_entities(bins, BIN);
+    save_entities(bots, ROBOT);
+}
+
+void BinRouter::savePath(int id, const Path& path, OutputSink& sink, int stage, bool under) {
     for (auto visit = path.begin(); visit != path.end(); ++visit) {
         auto& bids = visit->node->auction.getBids();
-        // lambda to save a csv entry
+        // lambda to save a path entry
         auto save_entry = [&](int z_offset) {
             float z = std::distance(bids.find(visit->price), bids.end()) - 1;
-            fprintf(save_file, "%d, %u, %d, %f, %f, %f, %f\r\n", stage, PATH, id,
-                    visit->node->position.get<0>(), visit->node->position.get<1>(),
-                    (visit + z_offset)->node->position.get<2>(), under ? -0.25f - z : 0.25f + z);
+            sink.writePath({stage, PATH, id, visit->node->position.get<0>(),
+                    visit->node->position.get<1>(), (visit + z_offset)->node->position.get<2>(),
+                    under ? -0.25f - z : 0.25f + z});
         };
         // if the node is an elevator
-        if (visit->node->custom_data) {
+        if (MapGen::attributes(visit->node).elevator) {
             // save entry if there is a previous floor
             if (visit > path.begin()) {
                 save_entry(-1);
@@ -238,87 +696,16 @@ void BinRouter::savePath(int id, const Path& path, FILE* save_file, int stage, b
     }
 }
 
-void BinRouter::savePaths(const PathSync& path_sync, FILE* save_file, int stage, bool under) {
-    assert(save_file);
-    for (auto& [id, info] : path_sync.getPaths()) {
-        if (info.path.size() < 2) {
+void BinRouter::savePaths(
+        const MultiPathPlanner& planner, OutputSink& sink, int stage, bool under) {
+    auto& agent_index = planner.getAgentIndex();
+    for (size_t id = 0; id < agent_index.size(); ++id) {
+        auto& path = agent_index.getPath(id);
+        if (path.size() < 2) {
             continue;
         }
-        savePath(std::stoi(id), info.path, save_file, stage, under);
-    }
-}
-
-void BinRouter::generateTraversalOrder(
-        std::vector<int>& traversal_order, const PathSync& path_sync) {
-    // initialize visit_count lookup table
-    auto& paths = path_sync.getPaths();
-    std::vector<uint8_t> visit_count(paths.size());
-
-    // initialize traversal stack in order of IDs
-    std::vector<int> stack;
-    stack.reserve(paths.size() * 2);
-    for (int i = paths.size() - 1; i >= 0; --i) {
-        stack.push_back(i);
-    }
-
-    // clear output buffer
-    traversal_order.clear();
-    traversal_order.reserve(paths.size());
-
-    // traverse path dependencies
-    while (!stack.empty()) {
-        // get path from ID at back of stack
-        int id = stack.back();
-        auto& path = paths.at(std::to_string(id)).path;
-        // remove if already visited
-        if (visit_count[id] > 0) {
-            stack.pop_back();
-        } else if (path_sync.checkWaitStatus(std::to_string(id)).blocked_progress < path.size()) {
-            // add dependencies on first visit
-            printf("%d: ", id);
-            for (auto visit = path.rbegin(); visit != path.rend(); ++visit) {
-                auto& bids = visit->node->auction.getBids();
-                auto higher_bid = visit->node->auction.getHigherBid(visit->price);
-                if (higher_bid != bids.end()) {
-                    int dep_id = std::stoi(higher_bid->second.bidder);
-                    if (visit_count[dep_id] == 0) {
-                        stack.push_back(dep_id);
-                    }
-                    printf("%d ", dep_id);
-                }
-            }
-            puts("");
-        }
-        // if a path is revisited, it means all dependencies are met
-        // log in traversal order but filter out trivial paths
-        if (visit_count[id] == 1 && path.size() > 1) {
-            traversal_order.push_back(id);
-            // printf("done %d\n", id);
-        }
-        // increment visit count
-        if (visit_count[id] < 255) {
-            ++visit_count[id];
-        }
-    }
-
-    for (int id : traversal_order) {
-        printf("->%d", id);
+        savePath(id, path, sink, stage, under);
     }
-    puts("");
-}
-
-float BinRouter::customTravelTime(const NodePtr& prev, const NodePtr& cur, const NodePtr& next) {
-    // initialize to 2D manhattan distance
-    // prev only exists for adjacent queries
-    float t = prev ? 1.0f
-                   : std::abs(cur->position.get<0>() - next->position.get<0>()) +
-                              std::abs(cur->position.get<1>() - next->position.get<1>());
-    // add elevator duration if exiting elevator or floor changed
-    if (cur->custom_data ||
-            !(next->custom_data || cur->position.get<2>() == next->position.get<2>())) {
-        t += _config.elevator_duration;
-    }
-    return t;
 }
 
 }  // namespace swarm_sim
@@ -0,0 +1,104 @@
+#include <swarm_sim/dependency_graph.hpp>
+#include <algorithm>
+#include <cassert>
+
+namespace swarm_sim {
+
+void DependencyGraph::build(const PathSync& path_sync, const AgentIndex& agent_index) {
+    size_t n_agents = agent_index.size();
+    _dependents.assign(n_agents, {});
+    _pending.assign(n_agents, 0);
+    _layers.assign(n_agents, 0);
+    _positions.assign(n_agents, NOT_SCHEDULED);
+    _ready.clear();
+    _n_layers = 0;
+    _remaining = 0;
+
+    // initialize traversal stack in order of IDs
+    std::vector<uint8_t> visit_count(n_agents);
+    std::vector<std::vector<size_t>> dependencies(n_agents);
+    std::vector<size_t> stack;
+    stack.reserve(n_agents * 2);
+    for (size_t i = n_agents; i > 0; --i) {
+        stack.push_back(i - 1);
+    }
+
+    // traverse path dependencies depth first
+    size_t position = 0;
+    while (!stack.empty()) {
+        size_t id = stack.back();
+        auto& path = agent_index.getPath(id);
+        // remove if already visited
+        if (visit_count[id] > 0) {
+            stack.pop_back();
+        } else if (path_sync.checkWaitStatus(agent_index.getId(id)).blocked_progress < path.size()) {
+            // add dependencies on first visit
+            auto& deps = dependencies[id];
+            for (auto visit = path.rbegin(); visit != path.rend(); ++visit) {
+                auto& bids = visit->node->auction.getBids();
+                auto higher_bid = visit->node->auction.getHigherBid(visit->price);
+                if (higher_bid == bids.end()) {
+                    continue;
+                }
+                size_t dep_id = agent_index.find(higher_bid->second.bidder);
+                assert(dep_id != AgentIndex::NOT_FOUND);
+                if (dep_id == id) {
+                    continue;
+                }
+                deps.push_back(dep_id);
+                if (visit_count[dep_id] == 0) {
+                    stack.push_back(dep_id);
+                }
+            }
+            std::sort(deps.begin(), deps.end());
+            deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+        }
+        // if a path is revisited, all its dependencies are finished or part of a cycle
+        // filter out trivial paths, dependencies on them are met from the start
+        if (visit_count[id] == 1 && path.size() > 1) {
+            size_t layer = 0;
+            for (size_t dep_id : dependencies[id]) {
+                if (_positions[dep_id] != NOT_SCHEDULED) {
+                    _dependents[dep_id].push_back(id);
+                    ++_pending[id];
+                    layer = std::max(layer, _layers[dep_id] + 1);
+                }
+            }
+            _layers[id] = layer;
+            _positions[id] = position++;
+            _n_layers = std::max(_n_layers, layer + 1);
+            ++_remaining;
+            if (!_pending[id]) {
+                _ready.emplace(layer, _positions[id], id);
+            }
+        }
+        // increment visit count
+        if (visit_count[id] < 255) {
+            ++visit_count[id];
+        }
+    }
+}
+
+void DependencyGraph::takeReady(size_t n, std::vector<size_t>& agents) {
+    agents.clear();
+    while (agents.size() < n && !_ready.empty()) {
+        agents.push_back(std::get<2>(*_ready.begin()));
+        _ready.erase(_ready.begin());
+    }
+}
+
+void DependencyGraph::retry(size_t agent) {
+    _ready.emplace(_layers[agent], _positions[agent], agent);
+}
+
+void DependencyGraph::complete(size_t agent) {
+    assert(_remaining > 0);
+    --_remaining;
+    for (size_t dependent : _dependents[agent]) {
+        if (!--_pending[dependent]) {
+            _ready.emplace(_layers[dependent], _positions[dependent], dependent);
+        }
+    }
+}
+
+}  // namespace swarm_sim
@@ -0,0 +1,81 @@
+#include <swarm_sim/evaluator.hpp>
+#include <algorithm>
+
+namespace swarm_sim {
+
+void PlanMetrics::append(const PlanMetrics& next) {
+    // agents start the next stage together once the slowest finished this one
+    for (size_t i = 0; i < next.agents.size(); ++i) {
+        if (i == agents.size()) {
+            agents.push_back({0, 0, makespan, 0});
+        }
+        auto& agent = agents[i];
+        auto& next_agent = next.agents[i];
+        agent.travel_time += next_agent.travel_time;
+        agent.wait_time += next_agent.wait_time;
+        agent.finish_time = makespan + next_agent.finish_time;
+        agent.elevator_rides += next_agent.elevator_rides;
+    }
+    elevator_usage.resize(std::max(elevator_usage.size(), next.elevator_usage.size()));
+    for (size_t i = 0; i < next.elevator_usage.size(); ++i) {
+        elevator_usage[i] += next.elevator_usage[i];
+    }
+    makespan += next.makespan;
+    travel_time += next.travel_time;
+    wait_time += next.wait_time;
+    elevator_rides += next.elevator_rides;
+    elevator_wait_time += next.elevator_wait_time;
+}
+
+AgentMetrics Evaluator::evaluate(const Path& path, PlanMetrics* metrics) const {
+    AgentMetrics agent;
+    for (size_t i = 1; i < path.size(); ++i) {
+        auto& cur = path[i - 1];
+        auto& next = path[i];
+        // staying on a node only waits
+        float travel_time = 0;
+        if (next.node != cur.node) {
+            // visits are adjacent, the first move has no previous node
+            travel_time = _travel_time(i > 1 ? path[i - 2].node : cur.node, cur.node, next.node);
+        }
+        float wait_time = std::max(0.0f, next.time - cur.time - travel_time);
+        agent.travel_time += travel_time;
+        agent.wait_time += wait_time;
+        if (next.node == cur.node || !MapGen::attributes(next.node).elevator) {
+            continue;
+        }
+        ++agent.elevator_rides;
+        if (metrics) {
+            metrics->elevator_wait_time += wait_time;
+            auto found = std::find(_map.elevators.begin(), _map.elevators.end(), next.node);
+            if (found != _map.elevators.end()) {
+                metrics->elevator_usage.resize(_map.elevators.size());
+                ++metrics->elevator_usage[found - _map.elevators.begin()];
+            }
+        }
+    }
+    // visit times may be estimates that leave out the last moves
+    float elapsed = path.empty() ? 0 : path.back().time - path.front().time;
+    agent.finish_time = std::max(elapsed, agent.travel_time + agent.wait_time);
+    if (metrics) {
+        metrics->makespan = std::max(metrics->makespan, agent.finish_time);
+        metrics->travel_time += agent.travel_time;
+        metrics->wait_time += agent.wait_time;
+        metrics->elevator_rides += agent.elevator_rides;
+    }
+    return agent;
+}
+
+PlanMetrics Evaluator::evaluate(const MultiPathPlanner& planner) const {
+    PlanMetrics metrics;
+    metrics.elevator_usage.resize(_map.elevators.size());
+    auto& agent_index = planner.getAgentIndex();
+    size_t n_agents = agent_index.size();
+    metrics.agents.reserve(n_agents);
+    for (size_t i = 0; i < n_agents; ++i) {
+        metrics.agents.push_back(evaluate(agent_index.getPath(i), &metrics));
+    }
+    return metrics;
+}
+
+}  // namespace swarm_sim
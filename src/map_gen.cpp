@@ -1,9 +1,16 @@
 #include <swarm_sim/map_gen.hpp>
+#include <swarm_sim/map_snapshot.hpp>
 #include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iterator>
 
 namespace swarm_sim {
 
-MapGen::MapGen(const Config& config) {
+MapGen::MapGen(const Config& config)
+        : cols(config.cols)
+        , rows(config.rows)
+        , floors(config.floors) {
     // helper to convert indices
     const auto idx = [&config](size_t col, size_t row = 0, size_t flr = 0) {
         return col + (row * config.cols) + (flr * config.cols * config.rows);
@@ -14,66 +21,113 @@ MapGen::MapGen(const Config& config) {
     for (auto& [col, row] : config.elevators) {
         has_elevator[idx(col, row)] = true;
     }
-    // add 3D grid of nodes to graph
-    std::vector<NodePtr> nodes;
+    // nodes and their attributes are created in one pass, attributes are reserved up front
+    // so the custom_data pointers stay valid, shared elevator nodes keep the first floor entry
+    size_t n_cells = config.cols * config.rows * config.floors;
+    grid.reserve(n_cells);
+    node_attributes.reserve(n_cells);
     for (size_t flr = 0; flr < config.floors; ++flr) {
         for (size_t row = 0; row < config.rows; ++row) {
             for (size_t col = 0; col < config.cols; ++col) {
-                auto node =
-                        has_elevator[idx(col, row)]
-                                // make elevator node only for the first floor
-                                ? flr == 0 ? graph.insertNode(Point{static_cast<float>(col),
-                                                                      static_cast<float>(row), 0},
-                                                     Node::NO_STOPPING)
-                                           // every other floor with elevator references the first
-                                           : nodes[idx(col, row)]
-                                // if not an elevator add a new node
-                                : graph.insertNode(
-                                          Point{static_cast<float>(col), static_cast<float>(row),
-                                                  static_cast<float>(flr)},
-                                          Node::DEFAULT);
+                bool elevator = has_elevator[idx(col, row)];
+                auto& attributes = node_attributes.emplace_back(
+                        NodeAttributes{static_cast<uint32_t>(col), static_cast<uint32_t>(row),
+                                static_cast<uint32_t>(elevator ? 0 : flr), elevator});
+                // every other floor with elevator references the first
+                if (elevator && flr > 0) {
+                    grid.emplace_back(grid[idx(col, row)]);
+                    continue;
+                }
+                // make elevator node only for the first floor
+                auto node = graph.insertNode(
+                        Point{static_cast<float>(col), static_cast<float>(row),
+                                static_cast<float>(flr)},
+                        elevator ? Node::NO_STOPPING : Node::DEFAULT);
                 assert(node);
-                nodes.emplace_back(node);
+                node->custom_data = &attributes;
+                grid.emplace_back(std::move(node));
             }
         }
     }
-    assert(nodes.size() == config.cols * config.rows * config.floors);
+    assert(grid.size() == n_cells);
 
-    // add elevator nodes to list
+    // add elevator nodes to list, looked up in the grid instead of the spatial index
+    elevators.reserve(config.elevators.size());
     for (auto& [col, row] : config.elevators) {
-        auto ele = graph.findNode(Point{static_cast<float>(col), static_cast<float>(row), 0});
-        assert(ele);
-        ele->custom_data = (void*) 1;
-        elevators.emplace_back(ele);
+        elevators.emplace_back(grid[idx(col, row)]);
     }
-    // add edges to grid of nodes
+    // add edges to grid of nodes, reserved to the exact degree so no capacity is wasted
+    // elevator nodes collect the edges of every floor
+    std::vector<uint16_t> degrees(n_cells);
     for (size_t flr = 0; flr < config.floors; ++flr) {
         for (size_t row = 0; row < config.rows; ++row) {
             for (size_t col = 0; col < config.cols; ++col) {
-                auto& node = nodes[idx(col, row, flr)];
+                uint16_t degree = (col > 0) + (col < config.cols - 1) + (row > 0) +
+                                 (row < config.rows - 1);
+                // elevator edges are counted on the first floor cell
+                degrees[has_elevator[idx(col, row)] ? idx(col, row) : idx(col, row, flr)] +=
+                        degree;
+            }
+        }
+    }
+    for (size_t i = 0; i < n_cells; ++i) {
+        if (degrees[i]) {
+            grid[i]->edges.reserve(degrees[i]);
+        }
+    }
+    for (size_t flr = 0; flr < config.floors; ++flr) {
+        for (size_t row = 0; row < config.rows; ++row) {
+            for (size_t col = 0; col < config.cols; ++col) {
+                auto& node = grid[idx(col, row, flr)];
                 if (col > 0) {
-                    node->edges.push_back(nodes[idx(col - 1, row, flr)]);
+                    node->edges.push_back(grid[idx(col - 1, row, flr)]);
                 }
                 if (col < config.cols - 1) {
-                    node->edges.push_back(nodes[idx(col + 1, row, flr)]);
+                    node->edges.push_back(grid[idx(col + 1, row, flr)]);
                 }
                 if (row > 0) {
-                    node->edges.push_back(nodes[idx(col, row - 1, flr)]);
+                    node->edges.push_back(grid[idx(col, row - 1, flr)]);
                 }
                 if (row < config.rows - 1) {
-                    node->edges.push_back(nodes[idx(col, row + 1, flr)]);
+                    node->edges.push_back(grid[idx(col, row + 1, flr)]);
                 }
             }
         }
     }
-    // remove elevator nodes first list
-    nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
-                        [](const NodePtr& x) { return x->state == Node::NO_STOPPING; }),
-            nodes.end());
+    // floor distances from every elevator, same for every floor
+    elevator_distances.assign(cols * rows * elevators.size(), FLT_MAX);
+    for (size_t i = 0; i < elevators.size(); ++i) {
+        const auto distance = [&](const NodePtr& node) -> float& {
+            auto& attributes = MapGen::attributes(node);
+            return elevator_distances[idx(attributes.col, attributes.row) * elevators.size() + i];
+        };
+        distance(elevators[i]) = 0;
+        std::deque<NodePtr> queue{elevators[i]};
+        while (!queue.empty()) {
+            auto node = queue.front();
+            queue.pop_front();
+            // other elevators are reached but not expanded
+            if (node != elevators[i] && attributes(node).elevator) {
+                continue;
+            }
+            float next_distance = distance(node) + 1;
+            for (auto& next : node->edges) {
+                if (attributes(next).floor == 0 && next_distance < distance(next)) {
+                    distance(next) = next_distance;
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    // copy grid without elevator nodes
+    Nodes nodes;
+    nodes.reserve(grid.size());
+    std::remove_copy_if(grid.begin(), grid.end(), std::back_inserter(nodes),
+            [](const NodePtr& x) { return x->state == Node::NO_STOPPING; });
 
     // shuffle the index of nodes
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen(config.seed ? *config.seed : std::random_device{}());
     std::shuffle(nodes.begin(), nodes.end(), gen);
 
     size_t n_bins = std::min(config.n_bins, nodes.size());
@@ -85,4 +139,73 @@ MapGen::MapGen(const Config& config) {
     bins.resize(n_bins);
 }
 
+MapGen::MapGen(const MapSnapshot& snapshot, bool place_entities)
+        : cols(snapshot.getHeader().cols)
+        , rows(snapshot.getHeader().rows)
+        , floors(snapshot.getHeader().floors) {
+    assert(snapshot.good());
+    auto& header = snapshot.getHeader();
+    size_t n_cells = header.n_cells;
+    node_attributes.assign(snapshot.attributes, snapshot.attributes + n_cells);
+    // owner cells come before the cells sharing their node
+    grid.reserve(n_cells);
+    for (size_t i = 0; i < n_cells; ++i) {
+        size_t owner = snapshot.nodes[i];
+        assert(owner <= i);
+        if (owner < i) {
+            grid.emplace_back(grid[owner]);
+            continue;
+        }
+        auto& attributes = node_attributes[i];
+        auto node = graph.insertNode(
+                Point{static_cast<float>(attributes.col), static_cast<float>(attributes.row),
+                        static_cast<float>(attributes.floor)},
+                static_cast<Node::State>(snapshot.states[i]));
+        assert(node);
+        node->custom_data = &attributes;
+        grid.emplace_back(std::move(node));
+    }
+    for (size_t i = 0; i < n_cells; ++i) {
+        size_t begin = snapshot.edge_offsets[i];
+        size_t end = snapshot.edge_offsets[i + 1];
+        auto& edges = grid[i]->edges;
+        edges.reserve(end - begin);
+        for (size_t j = begin; j < end; ++j) {
+            edges.push_back(grid[snapshot.edges[j]]);
+        }
+    }
+    const auto nodes = [this](const uint32_t* cells, size_t n) {
+        Nodes result;
+        result.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            result.push_back(grid[cells[i]]);
+        }
+        return result;
+    };
+    elevators = nodes(snapshot.elevators, header.n_elevators);
+    elevator_distances.assign(snapshot.elevator_distances,
+            snapshot.elevator_distances + cols * rows * header.n_elevators);
+    if (place_entities) {
+        bins = nodes(snapshot.bins, header.n_bins);
+        bots = nodes(snapshot.bots, header.n_bots);
+    }
+}
+
+NodePtr MapGen::at(size_t col, size_t row, size_t floor) const {
+    if (col >= cols || row >= rows || floor >= floors) {
+        return nullptr;
+    }
+    return grid[col + (row * cols) + (floor * cols * rows)];
+}
+
+NodePtr MapGen::find(const Point& position) const {
+    long col = std::lround(position.get<0>());
+    long row = std::lround(position.get<1>());
+    long floor = std::lround(position.get<2>());
+    if (col < 0 || row < 0 || floor < 0) {
+        return nullptr;
+    }
+    return at(col, row, floor);
+}
+
 }  // namespace swarm_sim
@@ -0,0 +1,206 @@
+#include <swarm_sim/map_snapshot.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace swarm_sim {
+
+constexpr size_t N_SECTIONS = 9;
+
+static size_t align(size_t offset) { return (offset + 7) & ~static_cast<size_t>(7); }
+
+// byte offset of each array in the file, the last entry is the file size
+static std::array<size_t, N_SECTIONS + 1> sectionOffsets(const MapSnapshot::Header& header) {
+    size_t n_distances = static_cast<size_t>(header.cols) * header.rows * header.n_elevators;
+    const std::array<size_t, N_SECTIONS> sizes = {header.n_cells * sizeof(uint32_t),
+            header.n_cells * sizeof(uint8_t), header.n_cells * sizeof(MapGen::NodeAttributes),
+            (header.n_cells + 1) * sizeof(uint64_t), header.n_edges * sizeof(uint32_t),
+            header.n_elevators * sizeof(uint32_t), n_distances * sizeof(float),
+            header.n_bins * sizeof(uint32_t), header.n_bots * sizeof(uint32_t)};
+    std::array<size_t, N_SECTIONS + 1> offsets;
+    offsets[0] = align(sizeof(MapSnapshot::Header));
+    for (size_t i = 0; i < N_SECTIONS; ++i) {
+        offsets[i + 1] = align(offsets[i] + sizes[i]);
+    }
+    return offsets;
+}
+
+bool MapSnapshot::save(const MapGen& map, const char* file) {
+    // nodes are referenced by the grid cell they were created for
+    const auto cell = [&map](const NodePtr& node) {
+        auto& attributes = MapGen::attributes(node);
+        return static_cast<uint32_t>(attributes.col + attributes.row * map.cols +
+                                     attributes.floor * map.cols * map.rows);
+    };
+    const auto cells = [&cell](const Nodes& nodes) {
+        std::vector<uint32_t> ids;
+        ids.reserve(nodes.size());
+        for (auto& node : nodes) {
+            ids.push_back(cell(node));
+        }
+        return ids;
+    };
+    size_t n_cells = map.grid.size();
+    std::vector<uint32_t> nodes = cells(map.grid);
+    std::vector<uint8_t> states(n_cells);
+    // zero initialized so padding bytes are written deterministically
+    std::vector<MapGen::NodeAttributes> attributes(n_cells);
+    std::vector<uint64_t> edge_offsets(n_cells + 1);
+    std::vector<uint32_t> edges;
+    for (size_t i = 0; i < n_cells; ++i) {
+        auto& src = map.node_attributes[i];
+        attributes[i].col = src.col;
+        attributes[i].row = src.row;
+        attributes[i].floor = src.floor;
+        attributes[i].elevator = src.elevator;
+        if (nodes[i] == i) {
+            auto& node = map.grid[i];
+            states[i] = static_cast<uint8_t>(node->state);
+            for (auto& next : node->edges) {
+                edges.push_back(cell(next));
+            }
+        }
+        edge_offsets[i + 1] = edges.size();
+    }
+    std::vector<uint32_t> elevators = cells(map.elevators);
+    std::vector<uint32_t> bins = cells(map.bins);
+    std::vector<uint32_t> bots = cells(map.bots);
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.cols = map.cols;
+    header.rows = map.rows;
+    header.floors = map.floors;
+    header.n_cells = n_cells;
+    header.n_edges = edges.size();
+    header.n_elevators = elevators.size();
+    header.n_bins = bins.size();
+    header.n_bots = bots.size();
+
+    FILE* fp = fopen(file, "wb");
+    if (!fp) {
+        return false;
+    }
+    // each array starts at its aligned section offset
+    auto offsets = sectionOffsets(header);
+    const std::array<std::pair<const void*, size_t>, N_SECTIONS> sections = {{
+            {nodes.data(), nodes.size() * sizeof(uint32_t)},
+            {states.data(), states.size() * sizeof(uint8_t)},
+            {attributes.data(), attributes.size() * sizeof(MapGen::NodeAttributes)},
+            {edge_offsets.data(), edge_offsets.size() * sizeof(uint64_t)},
+            {edges.data(), edges.size() * sizeof(uint32_t)},
+            {elevators.data(), elevators.size() * sizeof(uint32_t)},
+            {map.elevator_distances.data(), map.elevator_distances.size() * sizeof(float)},
+            {bins.data(), bins.size() * sizeof(uint32_t)},
+            {bots.data(), bots.size() * sizeof(uint32_t)},
+    }};
+    static constexpr char PADDING[8] = {};
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    size_t offset = sizeof(header);
+    for (size_t i = 0; ok && i < N_SECTIONS; ++i) {
+        auto [data, size] = sections[i];
+        ok = fwrite(PADDING, 1, offsets[i] - offset, fp) == offsets[i] - offset &&
+             (!size || fwrite(data, size, 1, fp) == 1);
+        offset = offsets[i] + size;
+    }
+    ok = ok && fwrite(PADDING, 1, offsets.back() - offset, fp) == offsets.back() - offset;
+    return fclose(fp) == 0 && ok;
+}
+
+MapSnapshot::MapSnapshot(const char* file) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            _data = static_cast<const char*>(data);
+            _size = st.st_size;
+        }
+    }
+    close(fd);
+    if (!_data) {
+        return;
+    }
+    // every array element takes at least a byte, larger counts would overflow the offsets
+    auto& header = getHeader();
+    uint64_t n_floor_cells = static_cast<uint64_t>(header.cols) * header.rows;
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) || header.version != VERSION ||
+            !header.floors || !n_floor_cells || n_floor_cells > _size ||
+            header.n_cells != n_floor_cells * header.floors || header.n_cells > _size ||
+            header.n_edges > _size || header.n_elevators > header.n_cells ||
+            header.n_bins > _size || header.n_bots > _size ||
+            sectionOffsets(header).back() != _size) {
+        unmap();
+        return;
+    }
+    auto offsets = sectionOffsets(header);
+    nodes = reinterpret_cast<const uint32_t*>(_data + offsets[0]);
+    states = reinterpret_cast<const uint8_t*>(_data + offsets[1]);
+    attributes = reinterpret_cast<const MapGen::NodeAttributes*>(_data + offsets[2]);
+    edge_offsets = reinterpret_cast<const uint64_t*>(_data + offsets[3]);
+    edges = reinterpret_cast<const uint32_t*>(_data + offsets[4]);
+    elevators = reinterpret_cast<const uint32_t*>(_data + offsets[5]);
+    elevator_distances = reinterpret_cast<const float*>(_data + offsets[6]);
+    bins = reinterpret_cast<const uint32_t*>(_data + offsets[7]);
+    bots = reinterpret_cast<const uint32_t*>(_data + offsets[8]);
+    if (!validate()) {
+        unmap();
+    }
+}
+
+bool MapSnapshot::validate() const {
+    auto& header = getHeader();
+    size_t n_cells = header.n_cells;
+    if (edge_offsets[0] || edge_offsets[n_cells] != header.n_edges) {
+        return false;
+    }
+    for (size_t i = 0; i < n_cells; ++i) {
+        // owners come first and own themselves, only owners have edges
+        size_t owner = nodes[i];
+        if (owner > i || nodes[owner] != owner || states[i] > Node::DISABLED ||
+                edge_offsets[i + 1] < edge_offsets[i] ||
+                (owner < i && edge_offsets[i + 1] != edge_offsets[i])) {
+            return false;
+        }
+        // attributes index the elevator distances and are read as bools
+        auto& cell = attributes[i];
+        uint8_t elevator;
+        memcpy(&elevator, reinterpret_cast<const char*>(&cell) +
+                        offsetof(MapGen::NodeAttributes, elevator), 1);
+        if (cell.col >= header.cols || cell.row >= header.rows || cell.floor >= header.floors ||
+                elevator > 1) {
+            return false;
+        }
+    }
+    const auto in_range = [n_cells](const uint32_t* cells, size_t n) {
+        return std::all_of(cells, cells + n, [n_cells](uint32_t cell) { return cell < n_cells; });
+    };
+    size_t n_distances = static_cast<size_t>(header.cols) * header.rows * header.n_elevators;
+    return in_range(edges, header.n_edges) && in_range(elevators, header.n_elevators) &&
+           in_range(bins, header.n_bins) && in_range(bots, header.n_bots) &&
+           std::all_of(elevator_distances, elevator_distances + n_distances,
+                   [](float distance) { return distance >= 0; });
+}
+
+void MapSnapshot::unmap() {
+    munmap(const_cast<char*>(_data), _size);
+    _data = nullptr;
+}
+
+MapSnapshot::~MapSnapshot() {
+    if (_data) {
+        munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+}  // namespace swarm_sim
@@ -0,0 +1,251 @@
+#include <swarm_sim/output_sink.hpp>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace swarm_sim {
+
+CsvSink::CsvSink(const char* file)
+        : _file(fopen(file, "w")) {
+    if (_file) {
+        fprintf(_file, "stage, type, id, x, y, z, t\r\n");
+    }
+}
+
+CsvSink::~CsvSink() {
+    if (_file) {
+        fclose(_file);
+    }
+}
+
+void CsvSink::writeEntity(const OutputEntry& entry) {
+    fprintf(_file, "%d, %u, %u, %f, %f, %f, %d\r\n", entry.stage, entry.type, entry.id, entry.x,
+            entry.y, entry.z, static_cast<int>(entry.t));
+}
+
+void CsvSink::writePath(const OutputEntry& entry) {
+    fprintf(_file, "%d, %u, %d, %f, %f, %f, %f\r\n", entry.stage, entry.type, entry.id, entry.x,
+            entry.y, entry.z, entry.t);
+}
+
+void CsvSink::flush() {
+    fflush(_file);
+}
+
+BinarySink::BinarySink(const char* file, size_t block_rows)
+        : _file(fopen(file, "wb"))
+        , _block_rows(block_rows) {
+    if (_file) {
+        fwrite(MAGIC, sizeof(MAGIC), 1, _file);
+    }
+}
+
+BinarySink::~BinarySink() {
+    if (_file) {
+        flush();
+        fclose(_file);
+    }
+}
+
+void BinarySink::writeEntity(const OutputEntry& entry) {
+    // skip entities that did not change since they were last written
+    auto [last, inserted] = _last_entities.try_emplace({entry.type, entry.id}, entry);
+    if (!inserted) {
+        if (last->second.x == entry.x && last->second.y == entry.y &&
+                last->second.z == entry.z && last->second.t == entry.t) {
+            return;
+        }
+        last->second = entry;
+    }
+    _entities.push_back(entry);
+    if (_entities.size() >= _block_rows) {
+        writeBlock(_entities, ENTITIES);
+    }
+}
+
+void BinarySink::writePath(const OutputEntry& entry) {
+    _paths.push_back(entry);
+    if (_paths.size() >= _block_rows) {
+        writeBlock(_paths, PATHS);
+    }
+}
+
+void BinarySink::flush() {
+    writeBlock(_entities, ENTITIES);
+    writeBlock(_paths, PATHS);
+    fflush(_file);
+}
+
+void BinarySink::writeBlock(std::vector<OutputEntry>& rows, BlockKind kind) {
+    if (rows.empty()) {
+        return;
+    }
+    uint32_t header[2] = {static_cast<uint32_t>(rows.size()), kind};
+    fwrite(header, sizeof(header), 1, _file);
+    // transpose rows into columns
+    std::vector<uint32_t> column(rows.size());
+    const auto write_column = [&](auto member) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            memcpy(&column[i], &(rows[i].*member), sizeof(uint32_t));
+        }
+        fwrite(column.data(), sizeof(uint32_t), column.size(), _file);
+    };
+    write_column(&OutputEntry::stage);
+    write_column(&OutputEntry::type);
+    write_column(&OutputEntry::id);
+    write_column(&OutputEntry::x);
+    write_column(&OutputEntry::y);
+    write_column(&OutputEntry::z);
+    write_column(&OutputEntry::t);
+    rows.clear();
+}
+
+BinaryReader::BinaryReader(const char* file) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(BinarySink::MAGIC)) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            _data = static_cast<const char*>(data);
+            _size = st.st_size;
+        }
+    }
+    close(fd);
+    if (_data && memcmp(_data, BinarySink::MAGIC, sizeof(BinarySink::MAGIC))) {
+        munmap(const_cast<char*>(_data), _size);
+        _data = nullptr;
+    }
+    if (!_data) {
+        return;
+    }
+    // index the blocks, stop at the first truncated block
+    size_t offset = sizeof(BinarySink::MAGIC);
+    while (offset + 2 * sizeof(uint32_t) <= _size) {
+        const uint32_t* header = reinterpret_cast<const uint32_t*>(_data + offset);
+        size_t n_rows = header[0];
+        offset += 2 * sizeof(uint32_t);
+        if (offset + 7 * n_rows * sizeof(uint32_t) > _size) {
+            break;
+        }
+        const auto column = [&](size_t i) { return _data + offset + i * n_rows * sizeof(float); };
+        _blocks.push_back({static_cast<BinarySink::BlockKind>(header[1]), n_rows,
+                reinterpret_cast<const int32_t*>(column(0)),
+                reinterpret_cast<const int32_t*>(column(1)),
+                reinterpret_cast<const int32_t*>(column(2)),
+                reinterpret_cast<const float*>(column(3)),
+                reinterpret_cast<const float*>(column(4)),
+                reinterpret_cast<const float*>(column(5)),
+                reinterpret_cast<const float*>(column(6))});
+        offset += 7 * n_rows * sizeof(uint32_t);
+    }
+}
+
+BinaryReader::~BinaryReader() {
+    if (_data) {
+        munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+std::vector<OutputEntry> BinaryReader::getEntities(int32_t stage) const {
+    // replay deltas up to stage, later entries override earlier ones
+    std::map<std::pair<int32_t, int32_t>, OutputEntry> entities;
+    for (auto& block : _blocks) {
+        if (block.kind != BinarySink::ENTITIES) {
+            continue;
+        }
+        for (size_t i = 0; i < block.n_rows && block.stage[i] <= stage; ++i) {
+            entities[{block.type[i], block.id[i]}] = {stage, block.type[i], block.id[i],
+                    block.x[i], block.y[i], block.z[i], block.t[i]};
+        }
+    }
+    std::vector<OutputEntry> snapshot;
+    snapshot.reserve(entities.size());
+    for (auto& [key, entry] : entities) {
+        snapshot.push_back(entry);
+    }
+    return snapshot;
+}
+
+std::vector<OutputEntry> BinaryReader::getPaths(int32_t stage) const {
+    std::vector<OutputEntry> paths;
+    for (auto& block : _blocks) {
+        if (block.kind != BinarySink::PATHS) {
+            continue;
+        }
+        for (size_t i = 0; i < block.n_rows; ++i) {
+            if (block.stage[i] == stage) {
+                paths.push_back({block.stage[i], block.type[i], block.id[i], block.x[i],
+                        block.y[i], block.z[i], block.t[i]});
+            }
+        }
+    }
+    return paths;
+}
+
+AsyncSink::AsyncSink(std::unique_ptr<OutputSink> sink)
+        : _sink(std::move(sink))
+        , _writer(&AsyncSink::writerLoop, this) {}
+
+AsyncSink::~AsyncSink() {
+    flush();
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _pending_cv.notify_one();
+    _writer.join();
+}
+
+void AsyncSink::writeEntity(const OutputEntry& entry) {
+    push(true, entry);
+}
+
+void AsyncSink::writePath(const OutputEntry& entry) {
+    push(false, entry);
+}
+
+void AsyncSink::push(bool entity, const OutputEntry& entry) {
+    std::lock_guard lock(_mutex);
+    _pending.push_back({entity, entry});
+    // wake writer only on the first pending entry, it drains everything queued meanwhile
+    if (_pending.size() == 1) {
+        _pending_cv.notify_one();
+    }
+}
+
+void AsyncSink::flush() {
+    std::unique_lock lock(_mutex);
+    _idle_cv.wait(lock, [this]() { return _pending.empty() && !_busy; });
+    _sink->flush();
+}
+
+void AsyncSink::writerLoop() {
+    std::vector<Pending> writing;
+    std::unique_lock lock(_mutex);
+    while (true) {
+        _pending_cv.wait(lock, [this]() { return _stop || !_pending.empty(); });
+        if (_pending.empty()) {
+            return;
+        }
+        // swap buffers and write without holding the lock
+        writing.swap(_pending);
+        _busy = true;
+        lock.unlock();
+        for (auto& pending : writing) {
+            pending.entity ? _sink->writeEntity(pending.entry) : _sink->writePath(pending.entry);
+        }
+        writing.clear();
+        lock.lock();
+        _busy = false;
+        if (_pending.empty()) {
+            _idle_cv.notify_all();
+        }
+    }
+}
+
+}  // namespace swarm_sim
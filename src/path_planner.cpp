@@ -1,8 +1,18 @@
 #include <swarm_sim/path_planner.hpp>
 #include <algorithm>
+#include <cassert>
 
 namespace decentralized_path_auction {
 
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// search iterations of the calling thread, counted by the wrapped travel time if enabled
+// an iteration queries the travel times of one expanded node, so count changes of that node
+static thread_local size_t t_iterations = 0;
+static thread_local const Node* t_expanded = nullptr;
+
 PathSearch::Error PathPlanner::plan(const PlanArgs& args, Nodes dst, float duration) {
     if (auto err = _path_search.setDestinations(std::move(dst), duration)) {
         return err;
@@ -26,6 +36,7 @@ PathSearch::Error PathPlanner::replan(const PlanArgs& args) {
     auto err = _path_search.iterate(_path, args.iterations, args.fallback_cost);
     // reset and try again if path search failed
     if (err > PathSearch::FALLBACK_DIVERTED) {
+        SWARM_SIM_TRACE_INSTANT("reset_cost_estimates");
         _path_search.resetCostEstimates();
         err = _path_search.iterate(_path, args.iterations, args.fallback_cost);
     }
@@ -34,115 +45,581 @@ PathSearch::Error PathPlanner::replan(const PlanArgs& args) {
 
 PathSearch::Error MultiPathPlanner::plan(
         const Config& config, const std::vector<Request>& requests) {
+    auto start = Clock::now();
+    if (auto err = initialize(requests, config.count_iterations)) {
+        return err;
+    }
+    // schedule every agent
+    return run(config, requests, start);
+}
+
+PathSearch::Error MultiPathPlanner::initialize(
+        const std::vector<Request>& requests, bool count_iterations) {
+    _stats = {};
+    _requests = requests.data();
     _path_sync.clearPaths();
+    for (auto& planner : _path_planners) {
+        _path_buffers.push_back(planner.releasePath());
+        _path_buffers.back().clear();
+    }
     _path_planners.clear();
     _results.clear();
+    _agent_index.clear();
+    _path_planners.reserve(requests.size());
+    _results.reserve(requests.size());
     // initialize path planners and set destination
     for (auto& req : requests) {
-        _path_planners.emplace_back(req.config);
-        _results.emplace_back(Result{
-                _path_planners.back().getPathSearch().setDestinations(req.dst, req.duration)});
-        if (_results.back().search_error) {
-            return _results.back().search_error;
+        auto& result = _results.emplace_back();
+        // the travel time is only wrapped when iterations are counted
+        PathSearch::Config search_config = req.config;
+        if (count_iterations) {
+            search_config.travel_time = [travel_time = req.config.travel_time](
+                                                const NodePtr& prev, const NodePtr& cur,
+                                                const NodePtr& next) {
+                if (cur.get() != t_expanded) {
+                    t_expanded = cur.get();
+                    ++t_iterations;
+                }
+                return travel_time(prev, cur, next);
+            };
         }
+        auto& planner = _path_planners.emplace_back(std::move(search_config));
+        if (!_path_buffers.empty()) {
+            planner.setPath(std::move(_path_buffers.back()));
+            _path_buffers.pop_back();
+        }
+        result.search_error = planner.getPathSearch().setDestinations(*req.dst, req.duration);
+        if (result.search_error) {
+            _stats.convergence = SEARCH_FAILED;
+            return result.search_error;
+        }
+        _agent_index.insert(req.config.agent_id);
     }
 
+    // every agent starts out unsatisfied until its first commit is checked
+    _satisfied.assign(requests.size(), false);
+    _dirty_stamps.assign(requests.size(), 0);
+    _dirty_versions.assign(requests.size(), 0);
+    _node_versions.clear();
+    _dirty.clear();
+    _dirty_stamp = 1;
+    _unsatisfied = requests.size();
+    _path_id = 0;
+    _version = 0;
+    return PathSearch::SUCCESS;
+}
+
+void MultiPathPlanner::importPaths(
+        const Config& config, MultiPathPlanner& other, const std::vector<size_t>& agents) {
+    assert(agents.size() == other._path_planners.size());
+    // imported paths are checked against the config of the run they are imported for
+    _config = config;
+    // take the committed paths before releasing their bids in the other planner
+    std::vector<Path> paths;
+    paths.reserve(agents.size());
+    for (size_t i = 0; i < agents.size(); ++i) {
+        paths.push_back(other._agent_index.getPath(i));
+    }
+    other._path_sync.clearPaths();
+    other._agent_index.clear();
+    for (size_t i = 0; i < agents.size(); ++i) {
+        size_t idx = agents[i];
+        auto& planner = _path_planners[idx];
+        planner.setPath(std::move(paths[i]));
+        _results[idx] = other._results[i];
+        if (planner.getPath().empty()) {
+            continue;
+        }
+        _results[idx].sync_error =
+                _path_sync.updatePath(planner.getId(), planner.getPath(), _path_id++);
+        _agent_index.bind(idx, _path_sync);
+    }
+    // imported agents that are already compatible do not need scheduling
+    for (size_t idx : agents) {
+        if (!_path_planners[idx].getPath().empty() && checkSatisfied(idx)) {
+            _satisfied[idx] = true;
+            --_unsatisfied;
+        }
+    }
+}
+
+PathSearch::Error MultiPathPlanner::replan(const Config& config,
+        const std::vector<Request>& requests, const std::vector<size_t>& agents) {
+    auto start = Clock::now();
+    _stats = {};
+    assert(requests.size() == _path_planners.size());
+    // replace destinations and restart paths of changed agents, others keep their paths
+    for (size_t idx : agents) {
+        auto& req = requests[idx];
+        auto& result = _results[idx];
+        result.search_error =
+                _path_planners[idx].getPathSearch().setDestinations(*req.dst, req.duration);
+        if (result.search_error) {
+            _stats.convergence = SEARCH_FAILED;
+            return result.search_error;
+        }
+        _path_planners[idx].resetPath();
+        if (_satisfied[idx]) {
+            _satisfied[idx] = false;
+            ++_unsatisfied;
+        }
+    }
+    // agents outbid by the changed ones get scheduled when their auctions are touched
+    return run(config, requests, start);
+}
+
+PathSearch::Error MultiPathPlanner::run(
+        const Config& config, const std::vector<Request>& requests, Clock::time_point start) {
     // setup thread shared data
     _countdown = static_cast<int>(config.rounds * requests.size());
-    _requests = &requests[0];
+    _requests = requests.data();
     _config = config;
     // cannot have more threads than there are paths
     _config.n_threads = std::min(config.n_threads, requests.size());
+    // nor more than a provided pool runs at once, the calling thread runs one of them
+    if (_thread_pool && !_owns_thread_pool) {
+        _config.n_threads = std::min(_config.n_threads, _thread_pool->size() + 1);
+    }
+    _finished = false;
+    _pending = 0;
+    _idle_threads = 0;
+    _stats.threads.resize(_config.n_threads);
+    _deadline = config.deadline;
+    if (config.time_limit > 0) {
+        auto time_limit = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(config.time_limit));
+        _deadline = std::min(_deadline, start + time_limit);
+    }
+    for (auto& result : _results) {
+        result.deferred = false;
+    }
+
+    // distribute unsatisfied agents to the work queue of their home thread
+    _work_queues = std::make_unique<WorkQueue[]>(_config.n_threads);
+    _queued.assign(requests.size(), false);
+    for (size_t idx = 0; idx < requests.size(); ++idx) {
+        if (!_satisfied[idx]) {
+            pushAgent(idx, false);
+        }
+    }
+    // nothing to schedule, confirm convergence up front
+    if (!_unsatisfied) {
+        for (size_t idx = 0; idx < requests.size(); ++idx) {
+            updateSatisfied(idx);
+        }
+        if (!_unsatisfied) {
+            _stats.convergence = CONVERGED;
+            _stats.wall_time = secondsSince(start);
+            return PathSearch::SUCCESS;
+        }
+    }
 
-    // spawn threads
-    std::vector<std::thread> threads;
-    for (size_t thread_idx = 0; thread_idx < _config.n_threads; ++thread_idx) {
-        threads.emplace_back(&MultiPathPlanner::thread_loop, this, thread_idx);
+    // create thread pool if there is none or the own one is too small
+    if (!_thread_pool || (_owns_thread_pool && _thread_pool->size() < _config.n_threads)) {
+        _thread_pool = std::make_shared<ThreadPool>(_config.n_threads, _config.cpu_affinity);
+        _owns_thread_pool = true;
     }
 
-    // wait for threads completion
-    for (auto& thread : threads) {
-        thread.join();
+    // run thread loops on pool and wait for completion
+    _thread_pool->run(_config.n_threads, [this](size_t thread_idx) { thread_loop(thread_idx); });
+    dropCandidates();
+    // threads stop without a result once the deadline passed
+    if (_stats.convergence == ROUNDS_EXHAUSTED && Clock::now() >= _deadline) {
+        _stats.convergence = DEADLINE_REACHED;
+        _countdown = 0;
+    }
+    // keep the best conflict free subset when the run did not converge
+    if (_stats.convergence == ROUNDS_EXHAUSTED || _stats.convergence == DEADLINE_REACHED) {
+        deferUnsatisfied();
     }
+    _stats.rounds = requests.empty() ? 0 : static_cast<float>(_stats.commits) / requests.size();
+    _stats.wall_time = secondsSince(start);
     return static_cast<PathSearch::Error>(-_countdown);
 }
 
-void MultiPathPlanner::thread_loop(size_t idx) {
-    size_t path_id = 0;
+void MultiPathPlanner::thread_loop(size_t thread_idx) {
     while (true) {
-        auto& request = _requests[idx];
+        // wait for agents that need planning until search is finished
+        size_t idx;
+        if (!popAgent(thread_idx, idx)) {
+            if (_finished) {
+                return;
+            }
+            // idle threads flush partial batches
+            if (_config.commit_batch) {
+                commitCandidates(thread_idx);
+            }
+            waitForAgents();
+            continue;
+        }
         auto& planner = _path_planners[idx];
         auto& result = _results[idx];
+        auto& thread_stats = _stats.threads[thread_idx];
         PathSearch::Error search_error;
+        size_t version;
         // replan path only requires read access
         {
+            auto wait_start = Clock::now();
+            SWARM_SIM_TRACE_BEGIN("shared_lock", idx);
             std::shared_lock lock(_shared_mutex);
+            SWARM_SIM_TRACE_END("shared_lock", idx);
+            thread_stats.shared_wait_time += secondsSince(wait_start);
             if (_countdown <= 0) {
+                finish();
+                return;
+            }
+            // skip agents that became satisfied while they were queued
+            if (_satisfied[idx]) {
+                _queued[idx] = false;
+                continue;
+            }
+            // stop before starting a replan that cannot be committed in time
+            if (Clock::now() >= _deadline) {
+                SWARM_SIM_TRACE_INSTANT("deadline_reached", idx);
+                finish();
                 return;
             }
-            search_error = planner.replan(request.args);
-            /*
-            printf("idx %d e %d p %f c %f fb %f\n", idx, search_error,
-                    planner.getPath().back().price, planner.getPath().back().cost_estimate,
-                    request.args.fallback_cost);
-            */
+            version = _version;
+            auto replan_start = Clock::now();
+            size_t iterations = t_iterations;
+            t_expanded = nullptr;
+            SWARM_SIM_TRACE_BEGIN("replan", idx);
+            search_error = planner.replan(_requests[idx].args);
+            SWARM_SIM_TRACE_END("replan", idx, search_error);
+            result.replan_time += secondsSince(replan_start);
+            result.iterations += t_iterations - iterations;
+            ++result.replans;
+        }
+        // queue the path for the committer instead of taking the write lock
+        if (_config.commit_batch) {
+            size_t n_candidates;
+            {
+                std::lock_guard lock(_candidates_mutex);
+                _candidates.push_back({idx, search_error, version});
+                n_candidates = _candidates.size();
+            }
+            if (n_candidates >= _config.commit_batch) {
+                commitCandidates(thread_idx);
+            }
+            continue;
         }
         // enter write lock
+        auto wait_start = Clock::now();
+        SWARM_SIM_TRACE_BEGIN("exclusive_lock", idx);
+        std::unique_lock lock(_shared_mutex);
+        SWARM_SIM_TRACE_END("exclusive_lock", idx);
+        thread_stats.exclusive_wait_time += secondsSince(wait_start);
+        if (!commit(thread_idx, idx, search_error)) {
+            return;
+        }
+    }
+}
+
+bool MultiPathPlanner::commit(size_t thread_idx, size_t idx, PathSearch::Error search_error) {
+    if (_countdown <= 0) {
+        finish();
+        return false;
+    }
+    --_countdown;
+    if (!_countdown) {
+        SWARM_SIM_TRACE_INSTANT("rounds_exhausted", idx);
+        _stats.convergence = ROUNDS_EXHAUSTED;
+        finish();
+    }
+    _queued[idx] = false;
+
+    auto& planner = _path_planners[idx];
+    auto& result = _results[idx];
+    result.search_error = search_error;
+    result.sync_error = PathSync::SUCCESS;
+    // terminate search if error occurered
+    if (search_error > PathSearch::ITERATIONS_REACHED) {
+        _countdown = -search_error;
+        _stats.convergence = SEARCH_FAILED;
+        finish();
+        SWARM_SIM_TRACE_INSTANT("search_error", idx, search_error);
+        return false;
+    }
+    // otherwise add to path sync, agents bidding on either the
+    // previous or the new path are affected by the commit
+    ++_version;
+    markDirty(_agent_index.getPath(idx));
+    result.sync_error = _path_sync.updatePath(planner.getId(), planner.getPath(), _path_id++);
+    if (!_agent_index.getPathInfo(idx)) {
+        _agent_index.bind(idx, _path_sync);
+    }
+    SWARM_SIM_TRACE_INSTANT("commit", idx, result.sync_error);
+    ++_stats.commits;
+    ++_stats.threads[thread_idx].commits;
+    markDirty(planner.getPath());
+    markDirty(idx);
+
+    // only re-check agents whose auctions were touched by this commit
+    for (size_t dirty_idx : _dirty) {
+        updateSatisfied(dirty_idx);
+    }
+    _dirty.clear();
+    ++_dirty_stamp;
+
+    // wait status can depend on agents further down a blocking chain
+    // so confirm with a full check before terminating
+    if (!_unsatisfied) {
+        for (size_t i = 0; i < _path_planners.size(); ++i) {
+            updateSatisfied(i);
+        }
+    }
+
+    // terminate when all paths are satisfactory
+    if (!_unsatisfied) {
+        SWARM_SIM_TRACE_INSTANT("converged", idx, _countdown);
+        _stats.convergence = CONVERGED;
+        _countdown = 0;
+        finish();
+        return false;
+    }
+    return !_finished;
+}
+
+void MultiPathPlanner::commitCandidates(size_t thread_idx) {
+    // candidates queued while another thread held the committer are committed by that
+    // thread once it is done, so keep going until none are left
+    while (!_finished) {
+        std::unique_lock committer(_committer_mutex, std::try_to_lock);
+        if (!committer.owns_lock()) {
+            return;
+        }
         {
-            std::unique_lock lock(_shared_mutex);
-            if (_countdown <= 0) {
-                return;
-            }
-            --_countdown;
-            if (!_countdown) {
-                printf("out of iter\n");
+            std::lock_guard lock(_candidates_mutex);
+            std::swap(_candidates, _committing);
+        }
+        if (_committing.empty()) {
+            return;
+        }
+        commitBatch(thread_idx);
+        committer.unlock();
+        std::lock_guard lock(_candidates_mutex);
+        if (_candidates.empty()) {
+            return;
+        }
+    }
+}
+
+void MultiPathPlanner::commitBatch(size_t thread_idx) {
+    auto wait_start = Clock::now();
+    SWARM_SIM_TRACE_BEGIN("exclusive_lock", thread_idx, _committing.size());
+    std::unique_lock lock(_shared_mutex);
+    SWARM_SIM_TRACE_END("exclusive_lock", thread_idx, _committing.size());
+    _stats.threads[thread_idx].exclusive_wait_time += secondsSince(wait_start);
+    ++_stats.batches;
+    size_t i = 0;
+    for (; i < _committing.size(); ++i) {
+        auto& candidate = _committing[i];
+        if (isStale(candidate) && _countdown > 0) {
+            SWARM_SIM_TRACE_INSTANT("commit_rejected", candidate.idx);
+            ++_stats.rejected;
+            if (!--_countdown) {
+                _stats.convergence = ROUNDS_EXHAUSTED;
+                finish();
+                break;
             }
+            pushAgent(candidate.idx, true);
+            continue;
+        }
+        if (!commit(thread_idx, candidate.idx, candidate.search_error)) {
+            ++i;
+            break;
+        }
+    }
+    // candidates after the end of the run are left for dropCandidates
+    if (i < _committing.size()) {
+        std::lock_guard candidates_lock(_candidates_mutex);
+        _candidates.insert(_candidates.end(), _committing.begin() + i, _committing.end());
+    }
+    _committing.clear();
+}
 
-            result = {search_error};
-            // terminate search if error occurered
-            if (search_error > PathSearch::ITERATIONS_REACHED) {
-                _countdown = -search_error;
-                printf("search error %d\n", search_error);
-                return;
+bool MultiPathPlanner::isStale(const Candidate& candidate) const {
+    // a commit since this path was planned touched the auctions of the agent's committed
+    // path or the nodes of its new one
+    if (_dirty_versions[candidate.idx] > candidate.version) {
+        return true;
+    }
+    for (auto& visit : _path_planners[candidate.idx].getPath()) {
+        auto found = _node_versions.find(visit.node.get());
+        if (found != _node_versions.end() && found->second > candidate.version) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MultiPathPlanner::dropCandidates() {
+    for (auto& candidate : _candidates) {
+        _path_planners[candidate.idx].setPath(_agent_index.getPath(candidate.idx));
+    }
+    _candidates.clear();
+}
+
+void MultiPathPlanner::deferUnsatisfied() {
+    // deferring agents only adds stationary paths, repeat until no agent is blocked by them
+    std::vector<bool> failed(_path_planners.size(), false);
+    bool deferred = true;
+    while (deferred) {
+        deferred = false;
+        for (size_t idx = 0; idx < _path_planners.size(); ++idx) {
+            if (_results[idx].deferred || failed[idx] || checkSatisfied(idx)) {
+                continue;
             }
-            // otherwise add to path sync
-            result.sync_error =
-                    _path_sync.updatePath(planner.getId(), planner.getPath(), path_id++);
-
-            // terminate when all paths are satisfactory
-            if (std::all_of(_path_planners.begin(), _path_planners.end(), [&](PathPlanner& p) {
-                    // check if there are any stale fallback paths
-                    int path_idx = &p - &_path_planners[0];
-                    if ((_requests[path_idx].dst.empty() ||
-                                (!p.getPath().empty() &&
-                                        _requests[path_idx].dst[0] == p.getPath().front().node)) &&
-                            _results[path_idx].search_error == PathSearch::FALLBACK_DIVERTED &&
-                            std::any_of(p.getPath().begin(), p.getPath().end() - 1,
-                                    [&p](const Visit& visit) {
-                                        return visit.node->state < Node::NO_PARKING &&
-                                               std::next(visit.node->auction.getBids().begin())
-                                                               ->second.bidder == p.getId();
-                                    })) {
-                        p.getPathSearch().resetCostEstimates();
-                        return false;
-                    }
-                    // check paths are compatible with each other
-                    auto& error = _results[path_idx].sync_error;
-                    error = _path_sync.checkWaitStatus(p.getId()).error;
-                    return error == PathSync::SUCCESS ||
-                           (error == PathSync::REMAINING_DURATION_INFINITE &&
-                                   _config.allow_indefinite_block);
-                })) {
-                printf("graceful took %d\n", _countdown);
-                _countdown = 0;
-                return;
+            // stay at the source with the bid of the committed path, agents without one or
+            // whose bid no longer holds select a new source bid
+            auto& planner = _path_planners[idx];
+            auto& result = _results[idx];
+            Path committed = _agent_index.getPath(idx);
+            if (!committed.empty()) {
+                planner.setPath({committed.front()});
+                result.sync_error =
+                        _path_sync.updatePath(planner.getId(), planner.getPath(), _path_id++);
+            }
+            if (committed.empty() || result.sync_error) {
+                planner.setPath({planner.getPathSearch().selectSource(_requests[idx].args.src)});
+                result.sync_error =
+                        _path_sync.updatePath(planner.getId(), planner.getPath(), _path_id++);
+            }
+            // removing the path would let other agents move through the source, keep the
+            // committed path and report the agent as failed instead
+            if (result.sync_error) {
+                planner.setPath(std::move(committed));
+                failed[idx] = true;
+                SWARM_SIM_TRACE_INSTANT("defer_failed", idx, result.sync_error);
+                continue;
+            }
+            result.deferred = true;
+            _agent_index.bind(idx, _path_sync);
+            if (_satisfied[idx]) {
+                _satisfied[idx] = false;
+                ++_unsatisfied;
             }
+            SWARM_SIM_TRACE_INSTANT("deferred", idx);
+            deferred = true;
         }
+    }
+}
+
+bool MultiPathPlanner::checkSatisfied(size_t idx) {
+    auto& p = _path_planners[idx];
+    auto& dst = *_requests[idx].dst;
+    // check if there are any stale fallback paths
+    if ((dst.empty() || (!p.getPath().empty() && dst[0] == p.getPath().front().node)) &&
+            _results[idx].search_error == PathSearch::FALLBACK_DIVERTED &&
+            std::any_of(p.getPath().begin(), p.getPath().end() - 1, [&p](const Visit& visit) {
+                return visit.node->state < Node::NO_PARKING &&
+                       std::next(visit.node->auction.getBids().begin())->second.bidder ==
+                               p.getId();
+            })) {
+        SWARM_SIM_TRACE_INSTANT("reset_cost_estimates", idx);
+        p.getPathSearch().resetCostEstimates();
+        return false;
+    }
+    // check paths are compatible with each other
+    auto& error = _results[idx].sync_error;
+    error = _path_sync.checkWaitStatus(p.getId()).error;
+    if (error != PathSync::SUCCESS) {
+        SWARM_SIM_TRACE_INSTANT("sync_error", idx, error);
+    }
+    return error == PathSync::SUCCESS ||
+           (error == PathSync::REMAINING_DURATION_INFINITE && _config.allow_indefinite_block);
+}
+
+void MultiPathPlanner::updateSatisfied(size_t idx) {
+    bool satisfied = checkSatisfied(idx);
+    if (satisfied != static_cast<bool>(_satisfied[idx])) {
+        _satisfied[idx] = satisfied;
+        satisfied ? --_unsatisfied : ++_unsatisfied;
+    }
+    // schedule unsatisfied agents, invalidated paths take priority over stale fallbacks
+    if (!satisfied && !_queued[idx]) {
+        pushAgent(idx, _results[idx].sync_error != PathSync::SUCCESS);
+    }
+}
+
+void MultiPathPlanner::pushAgent(size_t idx, bool priority) {
+    _queued[idx] = true;
+    // counted before it can be popped so the count never drops below the queued agents
+    ++_pending;
+    auto& work_queue = _work_queues[idx % _config.n_threads];
+    {
+        std::lock_guard lock(work_queue.mutex);
+        priority ? work_queue.agents.push_front(idx) : work_queue.agents.push_back(idx);
+    }
+    // parked threads count themselves before checking for work, so either they see
+    // the pending agent or they are already waiting to be notified
+    if (_idle_threads) {
+        std::lock_guard lock(_idle_mutex);
+        _idle_cv.notify_one();
+    }
+}
+
+bool MultiPathPlanner::popAgent(size_t thread_idx, size_t& idx) {
+    // no need to lock every queue when nothing is queued
+    if (!_pending) {
+        return false;
+    }
+    // take from the front of own queue first
+    {
+        auto& work_queue = _work_queues[thread_idx];
+        std::lock_guard lock(work_queue.mutex);
+        if (!work_queue.agents.empty()) {
+            idx = work_queue.agents.front();
+            work_queue.agents.pop_front();
+            --_pending;
+            return true;
+        }
+    }
+    // otherwise steal from the back of other queues
+    for (size_t i = 1; i < _config.n_threads; ++i) {
+        auto& work_queue = _work_queues[(thread_idx + i) % _config.n_threads];
+        std::lock_guard lock(work_queue.mutex);
+        if (!work_queue.agents.empty()) {
+            idx = work_queue.agents.back();
+            work_queue.agents.pop_back();
+            --_pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MultiPathPlanner::waitForAgents() {
+    std::unique_lock lock(_idle_mutex);
+    ++_idle_threads;
+    _idle_cv.wait(lock, [this]() { return _pending || _finished; });
+    --_idle_threads;
+}
 
-        // select next path to plan
-        idx += _config.n_threads;
-        if (idx >= _path_planners.size()) {
-            idx %= _config.n_threads;
+void MultiPathPlanner::finish() {
+    _finished = true;
+    std::lock_guard lock(_idle_mutex);
+    _idle_cv.notify_all();
+}
+
+void MultiPathPlanner::markDirty(size_t idx) {
+    _dirty_versions[idx] = _version;
+    if (_dirty_stamps[idx] != _dirty_stamp) {
+        _dirty_stamps[idx] = _dirty_stamp;
+        _dirty.push_back(idx);
+    }
+}
+
+void MultiPathPlanner::markDirty(const Path& path) {
+    for (auto& visit : path) {
+        if (_config.commit_batch) {
+            _node_versions[visit.node.get()] = _version;
+        }
+        for (auto& [price, bid] : visit.node->auction.getBids()) {
+            size_t bidder_idx = _agent_index.find(bid.bidder);
+            if (bidder_idx != AgentIndex::NOT_FOUND) {
+                markDirty(bidder_idx);
+            }
         }
     }
 }
@@ -0,0 +1,81 @@
+#include <swarm_sim/thread_pool.hpp>
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace decentralized_path_auction {
+
+ThreadPool::ThreadPool(size_t n_threads, const std::vector<int>& cpu_affinity)
+        : _cpu_affinity(cpu_affinity) {
+    _threads.reserve(n_threads);
+    for (size_t i = 0; i < n_threads; ++i) {
+        _threads.emplace_back(&ThreadPool::workerLoop, this, i);
+#ifdef __linux__
+        // pin worker to a cpu if affinity is provided
+        if (!_cpu_affinity.empty()) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(_cpu_affinity[i % _cpu_affinity.size()], &cpu_set);
+            pthread_setaffinity_np(_threads.back().native_handle(), sizeof(cpu_set), &cpu_set);
+        }
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _work_cv.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(size_t n_tasks, const Task& task) {
+    if (!n_tasks) {
+        return;
+    }
+    auto batch = std::make_shared<Batch>(Batch{&task, n_tasks});
+    std::unique_lock lock(_mutex);
+    _batches.push_back(batch);
+    _work_cv.notify_all();
+    // help out with own batch until there are no more tasks to claim
+    while (batch->next < batch->n_tasks) {
+        execute(lock, *batch);
+    }
+    // wait for workers to finish the remaining tasks
+    _done_cv.wait(lock, [&batch]() { return batch->done == batch->n_tasks; });
+}
+
+void ThreadPool::workerLoop(size_t) {
+    std::unique_lock lock(_mutex);
+    while (true) {
+        _work_cv.wait(lock, [this]() { return _stop || !_batches.empty(); });
+        if (_stop) {
+            return;
+        }
+        // hold a reference since the batch is popped once all its tasks are claimed
+        auto batch = _batches.front();
+        execute(lock, *batch);
+    }
+}
+
+void ThreadPool::execute(std::unique_lock<std::mutex>& lock, Batch& batch) {
+    size_t task_idx = batch.next++;
+    // remove batch from queue once the last task is claimed
+    if (batch.next == batch.n_tasks) {
+        _batches.erase(std::find_if(_batches.begin(), _batches.end(),
+                [&batch](const std::shared_ptr<Batch>& b) { return b.get() == &batch; }));
+    }
+    lock.unlock();
+    (*batch.task)(task_idx);
+    lock.lock();
+    if (++batch.done == batch.n_tasks) {
+        _done_cv.notify_all();
+    }
+}
+
+}  // namespace decentralized_path_auction
@@ -0,0 +1,75 @@
+#include <swarm_sim/tracer.hpp>
+#include <algorithm>
+#include <cstdio>
+
+namespace decentralized_path_auction {
+
+Tracer::Tracer()
+        : _start(std::chrono::steady_clock::now()) {}
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Buffer& Tracer::threadBuffer() {
+    // buffers are owned by the tracer and outlive their threads
+    thread_local Buffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard lock(_mutex);
+        auto& new_buffer = _buffers.emplace_back(std::make_unique<Buffer>());
+        new_buffer->events.resize(_capacity);
+        new_buffer->thread_id = static_cast<uint32_t>(_buffers.size() - 1);
+        buffer = new_buffer.get();
+    }
+    return *buffer;
+}
+
+void Tracer::record(Type type, const char* name, int64_t id, int64_t value) {
+    auto& buffer = threadBuffer();
+    if (buffer.events.empty()) {
+        return;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - _start;
+    int64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    buffer.events[buffer.count++ % buffer.events.size()] = {name, id, value, time_ns, type};
+}
+
+void Tracer::clear(size_t capacity) {
+    std::lock_guard lock(_mutex);
+    _capacity = capacity;
+    for (auto& buffer : _buffers) {
+        buffer->events.assign(capacity, {});
+        buffer->count = 0;
+    }
+}
+
+bool Tracer::exportChromeTrace(const char* file) const {
+    FILE* fp = fopen(file, "w");
+    if (!fp) {
+        return false;
+    }
+    static constexpr char PHASES[] = {'B', 'E', 'i'};
+    std::lock_guard lock(_mutex);
+    fputs("{\"traceEvents\":[\n", fp);
+    bool first = true;
+    for (auto& buffer : _buffers) {
+        // oldest event first once the ring buffer wrapped around
+        size_t size = buffer->events.size();
+        size_t n_events = std::min(buffer->count, size);
+        for (size_t i = buffer->count - n_events; i < buffer->count; ++i) {
+            auto& event = buffer->events[i % size];
+            fprintf(fp,
+                    "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,%s"
+                    "\"args\":{\"id\":%lld,\"value\":%lld}}",
+                    first ? "" : ",\n", event.name, PHASES[event.type], event.time_ns * 1e-3,
+                    buffer->thread_id, event.type == INSTANT ? "\"s\":\"t\"," : "",
+                    static_cast<long long>(event.id), static_cast<long long>(event.value));
+            first = false;
+        }
+    }
+    fputs("\n]}\n", fp);
+    return fclose(fp) == 0;
+}
+
+}  // namespace decentralized_path_auction
@@ -0,0 +1,665 @@
+#include <benchmark/benchmark.h>
+#include <swarm_sim/batch_runner.hpp>
+#include <swarm_sim/bin_router.hpp>
+#include <swarm_sim/bin_request_queue.hpp>
+#include <swarm_sim/map_snapshot.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
+
+using namespace swarm_sim;
+
+// heap allocations made while counting, only the allocation benchmarks turn it on so the
+// timings of the other benchmarks do not pay for the shared counter
+static std::atomic<bool> count_allocations{false};
+static std::atomic<size_t> allocation_count{0};
+
+void* operator new(size_t size) {
+    if (count_allocations.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+// small robot stage: every bot competes for every bin on a single floor
+std::vector<MultiPathPlanner::Request> makeStageRequests(const MapGen& map) {
+    PathSearch::Config path_search_config;
+    path_search_config.travel_time = [](const NodePtr& prev, const NodePtr& cur,
+                                             const NodePtr& next) {
+        return prev ? 1.0f
+                    : std::abs(cur->position.get<0>() - next->position.get<0>()) +
+                              std::abs(cur->position.get<1>() - next->position.get<1>());
+    };
+    auto dst = std::make_shared<const Nodes>(map.bins);
+    std::vector<MultiPathPlanner::Request> requests;
+    for (size_t i = 0; i < map.bots.size(); ++i) {
+        path_search_config.agent_id = std::to_string(i);
+        requests.push_back({dst, FLT_MAX, path_search_config, {{map.bots[i]}, 10000, 500}});
+    }
+    return requests;
+}
+
+MapGen::Config stageMapConfig(size_t n_agents) {
+    MapGen::Config config;
+    config.rows = 10;
+    config.cols = 10;
+    config.floors = 1;
+    config.n_bins = n_agents;
+    config.n_bots = n_agents;
+    return config;
+}
+
+MultiPathPlanner::Config stagePlannerConfig(size_t n_threads) {
+    MultiPathPlanner::Config config;
+    config.rounds = 100;
+    config.n_threads = n_threads;
+    config.allow_indefinite_block = false;
+    return config;
+}
+
+// args: grid size, floors, elevators, bins, bots, threads, requests
+BinRouter::Config pipelineConfig(const benchmark::State& state) {
+    BinRouter::Config config;
+    config.elevator_duration = 10.0f;
+    config.fallback_cost = 5000;
+    config.blocking_fallback_cost = 10.0f;
+    config.iterations = 100000;
+    config.planner_config.rounds = 1000;
+    config.planner_config.n_threads = state.range(5);
+    config.planner_config.allow_indefinite_block = false;
+    size_t size = state.range(0);
+    config.map_gen_config.rows = size;
+    config.map_gen_config.cols = size;
+    config.map_gen_config.floors = state.range(1);
+    config.map_gen_config.n_bins = state.range(3);
+    config.map_gen_config.n_bots = state.range(4);
+    config.map_gen_config.seed = 0;
+    // elevators at the corners first, then the middle of the edges
+    std::vector<std::pair<size_t, size_t>> elevators = {{0, 0}, {size - 1, size - 1},
+            {0, size - 1}, {size - 1, 0}, {size / 2, 0}, {size / 2, size - 1}, {0, size / 2},
+            {size - 1, size / 2}};
+    elevators.resize(std::min<size_t>(state.range(2), elevators.size()));
+    config.map_gen_config.elevators = std::move(elevators);
+    return config;
+}
+
+// seeded requests of distinct bins to distinct non elevator cells
+std::vector<BinRouter::BinRequest> pipelineRequests(const MapGen& map, size_t n_requests) {
+    return generateRequests(map, n_requests, 0);
+}
+
+// resident set size of the process from /proc/self/statm, 0 if unavailable
+size_t residentBytes() {
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (!fp) {
+        return 0;
+    }
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (fscanf(fp, "%zu %zu", &total_pages, &resident_pages) != 2) {
+        resident_pages = 0;
+    }
+    fclose(fp);
+    return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+}  // namespace
+
+// full map gen -> bin plan -> robot plan pipeline with per phase wall times
+static void BM_pipeline(benchmark::State& state) {
+    auto config = pipelineConfig(state);
+    NullSink sink;
+    double map_gen_time = 0;
+    BinRouter::Stats total;
+    size_t stages = 0;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        BinRouter bin_router(config);
+        map_gen_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                                .count();
+        auto requests = pipelineRequests(bin_router.getMap(), state.range(6));
+        if (bin_router.solve(requests, sink) != BinRouter::SUCCESS) {
+            state.SkipWithError("solve failed");
+            break;
+        }
+        auto& stats = bin_router.getStats();
+        total.bin_plan_time += stats.bin_plan_time;
+        total.robot_plan_time += stats.robot_plan_time;
+        total.bin_replans += stats.bin_replans;
+        total.robot_replans += stats.robot_replans;
+        total.bin_layers += stats.bin_layers;
+        total.robot_metrics.makespan += stats.robot_metrics.makespan;
+        total.robot_metrics.wait_time += stats.robot_metrics.wait_time;
+        stages += stats.stages.size();
+    }
+    using benchmark::Counter;
+    state.counters["map_gen_ms"] = Counter(map_gen_time * 1e3, Counter::kAvgIterations);
+    state.counters["bin_plan_ms"] = Counter(total.bin_plan_time * 1e3, Counter::kAvgIterations);
+    state.counters["robot_plan_ms"] =
+            Counter(total.robot_plan_time * 1e3, Counter::kAvgIterations);
+    state.counters["bin_replans"] = Counter(total.bin_replans, Counter::kAvgIterations);
+    state.counters["robot_replans"] = Counter(total.robot_replans, Counter::kAvgIterations);
+    state.counters["stages"] = Counter(stages, Counter::kAvgIterations);
+    state.counters["bin_layers"] = Counter(total.bin_layers, Counter::kAvgIterations);
+    state.counters["makespan"] = Counter(total.robot_metrics.makespan, Counter::kAvgIterations);
+    state.counters["wait_time"] = Counter(total.robot_metrics.wait_time, Counter::kAvgIterations);
+}
+BENCHMARK(BM_pipeline)
+        ->ArgNames({"size", "floors", "elevators", "bins", "bots", "threads", "requests"})
+        // grid size and floors
+        ->Args({10, 1, 4, 50, 5, 8, 4})
+        ->Args({10, 3, 4, 200, 5, 8, 4})
+        ->Args({20, 3, 4, 800, 10, 8, 8})
+        ->Args({20, 6, 4, 1600, 10, 8, 8})
+        // elevator count
+        ->Args({20, 3, 1, 800, 10, 8, 8})
+        ->Args({20, 3, 8, 800, 10, 8, 8})
+        // bin and bot counts
+        ->Args({20, 3, 4, 400, 10, 8, 16})
+        ->Args({20, 3, 4, 800, 20, 8, 16})
+        // threads
+        ->Args({20, 3, 4, 800, 10, 1, 8})
+        ->Args({20, 3, 4, 800, 10, 4, 8})
+        ->Args({20, 3, 4, 800, 10, 16, 8})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// robot stages saved after planning each stage or while planning the next one
+static void BM_pipelined_stages(benchmark::State& state) {
+    auto config = pipelineConfig(state);
+    config.pipelined = state.range(7);
+    for (auto _ : state) {
+        state.PauseTiming();
+        BinRouter bin_router(config);
+        auto requests = pipelineRequests(bin_router.getMap(), state.range(6));
+        if (bin_router.planBinPaths(requests) != BinRouter::SUCCESS) {
+            state.SkipWithError("bin planning failed");
+            break;
+        }
+        CsvSink sink("benchmark_stages.csv");
+        state.ResumeTiming();
+        if (bin_router.planStages(sink) != BinRouter::SUCCESS) {
+            state.SkipWithError("stage planning failed");
+            break;
+        }
+    }
+}
+BENCHMARK(BM_pipelined_stages)
+        ->ArgNames({"size", "floors", "elevators", "bins", "bots", "threads", "requests",
+                "pipelined"})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 0})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 1})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// bin planning in one planner or partitioned by floor with cross floor bins stitched in
+static void BM_partitioned_bins(benchmark::State& state) {
+    auto config = pipelineConfig(state);
+    config.partition_floors = state.range(7);
+    size_t bin_replans = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        BinRouter bin_router(config);
+        auto requests = pipelineRequests(bin_router.getMap(), state.range(6));
+        state.ResumeTiming();
+        if (bin_router.planBinPaths(requests) != BinRouter::SUCCESS) {
+            state.SkipWithError("bin planning failed");
+            break;
+        }
+        bin_replans += bin_router.getStats().bin_replans;
+    }
+    state.counters["bin_replans"] =
+            benchmark::Counter(bin_replans, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_partitioned_bins)
+        ->ArgNames({"size", "floors", "elevators", "bins", "bots", "threads", "requests",
+                "partitioned"})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 0})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 1})
+        ->Args({20, 6, 4, 1600, 10, 8, 32, 0})
+        ->Args({20, 6, 4, 1600, 10, 8, 32, 1})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// bin planning with the manhattan or the elevator detour estimate for cross floor bins
+static void BM_elevator_heuristic(benchmark::State& state) {
+    auto config = pipelineConfig(state);
+    config.elevator_heuristic = state.range(7);
+    config.planner_config.count_iterations = true;
+    size_t iterations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        BinRouter bin_router(config);
+        auto requests = pipelineRequests(bin_router.getMap(), state.range(6));
+        state.ResumeTiming();
+        if (bin_router.planBinPaths(requests) != BinRouter::SUCCESS) {
+            state.SkipWithError("bin planning failed");
+            break;
+        }
+        for (auto& result : bin_router.getStats().stages[0].agents) {
+            iterations += result.iterations;
+        }
+    }
+    state.counters["iterations"] =
+            benchmark::Counter(iterations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_elevator_heuristic)
+        ->ArgNames({"size", "floors", "elevators", "bins", "bots", "threads", "requests",
+                "heuristic"})
+        ->Args({20, 3, 1, 800, 10, 8, 16, 0})
+        ->Args({20, 3, 1, 800, 10, 8, 16, 1})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 0})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 1})
+        ->Args({40, 3, 4, 3200, 10, 8, 32, 0})
+        ->Args({40, 3, 4, 3200, 10, 8, 32, 1})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// robot stages with every robot bidding on every bin or with assigned candidates
+static void BM_robot_assignment(benchmark::State& state) {
+    auto config = pipelineConfig(state);
+    config.assignment_candidates = state.range(7);
+    NullSink sink;
+    size_t robot_replans = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        BinRouter bin_router(config);
+        auto requests = pipelineRequests(bin_router.getMap(), state.range(6));
+        if (bin_router.planBinPaths(requests) != BinRouter::SUCCESS) {
+            state.SkipWithError("bin planning failed");
+            break;
+        }
+        state.ResumeTiming();
+        if (bin_router.planStages(sink) != BinRouter::SUCCESS) {
+            state.SkipWithError("stage planning failed");
+            break;
+        }
+        robot_replans += bin_router.getStats().robot_replans;
+    }
+    state.counters["robot_replans"] =
+            benchmark::Counter(robot_replans, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_robot_assignment)
+        ->ArgNames({"size", "floors", "elevators", "bins", "bots", "threads", "requests",
+                "candidates"})
+        // more robots than bins
+        ->Args({20, 3, 4, 800, 20, 8, 4, 0})
+        ->Args({20, 3, 4, 800, 20, 8, 4, 1})
+        ->Args({20, 3, 4, 800, 20, 8, 4, 3})
+        // more bins than robots
+        ->Args({20, 3, 4, 800, 10, 8, 32, 0})
+        ->Args({20, 3, 4, 800, 10, 8, 32, 1})
+        ->Args({20, 3, 4, 800, 10, 8, 32, 3})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// requests pushed at a fixed rate and planned by a stream with the given horizon in ms
+static void BM_stream(benchmark::State& state) {
+    auto config = pipelineConfig(state);
+    double horizon = state.range(7) * 1e-3;
+    auto interval = std::chrono::milliseconds(state.range(8));
+    NullSink sink;
+    double latency = 0;
+    size_t n_latencies = 0;
+    size_t max_depth = 0;
+    size_t cycles = 0;
+    for (auto _ : state) {
+        BinRouter bin_router(config);
+        auto requests = pipelineRequests(bin_router.getMap(), state.range(6));
+        BinRequestQueue queue;
+        std::thread producer([&]() {
+            for (auto& request : requests) {
+                queue.push(request);
+                std::this_thread::sleep_for(interval);
+            }
+            queue.close();
+        });
+        auto error = bin_router.stream(queue, sink, horizon);
+        producer.join();
+        if (error != BinRouter::SUCCESS) {
+            state.SkipWithError("stream failed");
+            break;
+        }
+        auto& stats = bin_router.getStreamStats();
+        latency = std::accumulate(stats.latencies.begin(), stats.latencies.end(), latency);
+        n_latencies += stats.latencies.size();
+        for (size_t depth : stats.queue_depths) {
+            max_depth = std::max(max_depth, depth);
+        }
+        cycles += stats.cycles;
+    }
+    using benchmark::Counter;
+    state.counters["latency_ms"] = n_latencies ? latency * 1e3 / n_latencies : 0;
+    state.counters["max_queue_depth"] = max_depth;
+    state.counters["cycles"] = Counter(cycles, Counter::kAvgIterations);
+}
+BENCHMARK(BM_stream)
+        ->ArgNames({"size", "floors", "elevators", "bins", "bots", "threads", "requests",
+                "horizon", "interval"})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 50, 10})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 200, 10})
+        ->Args({20, 3, 4, 800, 10, 8, 16, 50, 2})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// one planner reused across stages with its persistent worker pool
+static void BM_stage_persistent_pool(benchmark::State& state) {
+    MapGen map(stageMapConfig(state.range(0)));
+    auto requests = makeStageRequests(map);
+    auto config = stagePlannerConfig(state.range(1));
+    MultiPathPlanner planner;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.plan(config, requests));
+    }
+}
+BENCHMARK(BM_stage_persistent_pool)
+        ->ArgsProduct({{2, 5}, {1, 4, 8}})
+        ->Unit(benchmark::kMicrosecond)
+        ->UseRealTime();
+
+// fresh pool per stage, equivalent to spawning and joining threads on every plan()
+static void BM_stage_fresh_pool(benchmark::State& state) {
+    MapGen map(stageMapConfig(state.range(0)));
+    auto requests = makeStageRequests(map);
+    auto config = stagePlannerConfig(state.range(1));
+    MultiPathPlanner planner;
+    for (auto _ : state) {
+        planner.setThreadPool(nullptr);
+        benchmark::DoNotOptimize(planner.plan(config, requests));
+    }
+}
+BENCHMARK(BM_stage_fresh_pool)
+        ->ArgsProduct({{2, 5}, {1, 4, 8}})
+        ->Unit(benchmark::kMicrosecond)
+        ->UseRealTime();
+
+// heap allocations of repeated stage plans, per plan and per commit
+// the baseline builds stages as before shared destinations and path buffer reuse, with a
+// destination copy per request and a fresh planner per plan that shares the thread pool
+static void BM_stage_allocations(benchmark::State& state) {
+    MapGen map(stageMapConfig(state.range(0)));
+    auto requests = makeStageRequests(map);
+    auto config = stagePlannerConfig(state.range(1));
+    bool reuse = state.range(2);
+    MultiPathPlanner planner;
+    // first plan creates the thread pool and path buffers
+    planner.plan(config, requests);
+    size_t allocations = 0;
+    size_t commits = 0;
+    count_allocations = true;
+    for (auto _ : state) {
+        size_t start = allocation_count;
+        if (reuse) {
+            benchmark::DoNotOptimize(planner.plan(config, requests));
+            commits += planner.getStats().commits;
+        } else {
+            for (auto& request : requests) {
+                request.dst = std::make_shared<const Nodes>(*request.dst);
+            }
+            MultiPathPlanner baseline(planner.getThreadPool());
+            benchmark::DoNotOptimize(baseline.plan(config, requests));
+            commits += baseline.getStats().commits;
+        }
+        allocations += allocation_count - start;
+    }
+    count_allocations = false;
+    using benchmark::Counter;
+    state.counters["allocs"] = Counter(allocations, Counter::kAvgIterations);
+    state.counters["allocs_per_commit"] = commits ? static_cast<double>(allocations) / commits : 0;
+}
+BENCHMARK(BM_stage_allocations)
+        ->ArgsProduct({{5, 20}, {1, 8}, {0, 1}})
+        ->ArgNames({"agents", "threads", "reuse"})
+        ->Unit(benchmark::kMicrosecond)
+        ->UseRealTime();
+
+// each bot is sent to its own bin so commits scale with the number of agents
+static void BM_commit_throughput(benchmark::State& state) {
+    MapGen::Config map_config = stageMapConfig(state.range(0));
+    map_config.rows = 30;
+    map_config.cols = 30;
+    MapGen map(map_config);
+    auto requests = makeStageRequests(map);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        requests[i].dst = std::make_shared<const Nodes>(Nodes{map.bins[i]});
+    }
+    auto config = stagePlannerConfig(8);
+    MultiPathPlanner planner;
+    size_t commits = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.plan(config, requests));
+        commits += planner.getStats().commits;
+    }
+    state.counters["commits"] =
+            benchmark::Counter(commits, benchmark::Counter::kAvgIterations);
+    state.counters["commit_rate"] = benchmark::Counter(commits, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_commit_throughput)
+        ->RangeMultiplier(2)
+        ->Range(25, 400)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// contended stage with many agents, commits count the replans spent until convergence
+static void BM_thread_scaling(benchmark::State& state) {
+    MapGen::Config map_config = stageMapConfig(200);
+    map_config.rows = 30;
+    map_config.cols = 30;
+    MapGen map(map_config);
+    auto requests = makeStageRequests(map);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        requests[i].dst = std::make_shared<const Nodes>(Nodes{map.bins[i]});
+    }
+    auto config = stagePlannerConfig(state.range(0));
+    MultiPathPlanner planner;
+    size_t commits = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.plan(config, requests));
+        commits += planner.getStats().commits;
+    }
+    state.counters["commits"] =
+            benchmark::Counter(commits, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_thread_scaling)
+        ->RangeMultiplier(2)
+        ->Range(8, 64)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// contended stage committed per replan or in batches, against thread count
+static void BM_batched_commits(benchmark::State& state) {
+    MapGen::Config map_config = stageMapConfig(200);
+    map_config.rows = 30;
+    map_config.cols = 30;
+    MapGen map(map_config);
+    auto requests = makeStageRequests(map);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        requests[i].dst = std::make_shared<const Nodes>(Nodes{map.bins[i]});
+    }
+    auto config = stagePlannerConfig(state.range(0));
+    config.commit_batch = state.range(1);
+    MultiPathPlanner planner;
+    MultiPathPlanner::Stats total;
+    double exclusive_wait_time = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.plan(config, requests));
+        auto& stats = planner.getStats();
+        total.commits += stats.commits;
+        total.rejected += stats.rejected;
+        total.rounds += stats.rounds;
+        for (auto& thread_stats : stats.threads) {
+            exclusive_wait_time += thread_stats.exclusive_wait_time;
+        }
+    }
+    using benchmark::Counter;
+    state.counters["commit_rate"] = Counter(total.commits, Counter::kIsRate);
+    state.counters["rejected"] = Counter(total.rejected, Counter::kAvgIterations);
+    state.counters["rounds"] = Counter(total.rounds, Counter::kAvgIterations);
+    state.counters["exclusive_wait_ms"] =
+            Counter(exclusive_wait_time * 1e3, Counter::kAvgIterations);
+}
+BENCHMARK(BM_batched_commits)
+        ->ArgNames({"threads", "batch"})
+        ->ArgsProduct({{1, 4, 8, 16, 32}, {0, 4, 16}})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// travel time of the baseline BinRouter kept verbatim, elevators are marked by custom_data
+struct LegacyRouter {
+    struct {
+        float elevator_duration;
+    } _config;
+
+    float customTravelTime(const NodePtr& prev, const NodePtr& cur, const NodePtr& next) {
+        // initialize to 2D manhattan distance
+        // prev only exists for adjacent queries
+        float t = prev ? 1.0f
+                       : std::abs(cur->position.get<0>() - next->position.get<0>()) +
+                                 std::abs(cur->position.get<1>() - next->position.get<1>());
+        // add elevator duration if exiting elevator or floor changed
+        if (cur->custom_data ||
+                !(next->custom_data || cur->position.get<2>() == next->position.get<2>())) {
+            t += _config.elevator_duration;
+        }
+        return t;
+    }
+};
+
+// travel time queries of a search over a multi floor map: edge expansions and heuristics
+static void BM_travel_time(benchmark::State& state) {
+    MapGen::Config map_config = stageMapConfig(0);
+    map_config.rows = 20;
+    map_config.cols = 20;
+    map_config.floors = 3;
+    map_config.elevators = {{0, 0}, {19, 19}, {0, 19}, {19, 0}};
+    MapGen map(map_config);
+    std::vector<std::array<NodePtr, 3>> queries;
+    for (auto& node : map.grid) {
+        for (auto& next : node->edges) {
+            queries.push_back({node, node, next});
+        }
+        queries.push_back({nullptr, node, map.grid[map.grid.size() / 2]});
+    }
+    const float elevator_duration = 10.0f;
+    // the baseline marked only elevators with custom_data, so it queries copies of the nodes
+    std::unordered_map<NodePtr, NodePtr> legacy_nodes;
+    for (auto& node : map.grid) {
+        auto& legacy_node = legacy_nodes[node];
+        if (!legacy_node) {
+            legacy_node = std::make_shared<Node>(node->position, node->state);
+            legacy_node->custom_data = MapGen::attributes(node).elevator ? (void*) 1 : nullptr;
+        }
+    }
+    std::vector<std::array<NodePtr, 3>> legacy_queries;
+    for (auto& [prev, cur, next] : queries) {
+        legacy_queries.push_back({prev ? legacy_nodes.at(prev) : nullptr, legacy_nodes.at(cur),
+                legacy_nodes.at(next)});
+    }
+    // baseline std::function lambda calling the router member
+    LegacyRouter legacy_router{{elevator_duration}};
+    std::function<float(const NodePtr&, const NodePtr&, const NodePtr&)> legacy =
+            [router = &legacy_router](const NodePtr& prev, const NodePtr& cur,
+                    const NodePtr& next) { return router->customTravelTime(prev, cur, next); };
+    std::function<float(const NodePtr&, const NodePtr&, const NodePtr&)> wrapped =
+            WarehouseTravelTime{elevator_duration};
+    WarehouseTravelTime inlined{elevator_duration};
+    auto& policy_queries = state.range(0) ? queries : legacy_queries;
+    for (auto _ : state) {
+        float sum = 0;
+        for (auto& [prev, cur, next] : policy_queries) {
+            switch (state.range(0)) {
+                case 0:
+                    sum += legacy(prev, cur, next);
+                    break;
+                case 1:
+                    sum += wrapped(prev, cur, next);
+                    break;
+                default:
+                    sum += inlined(prev, cur, next);
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+// 0: baseline std::function lambda, 1: std::function policy, 2: inlined policy
+BENCHMARK(BM_travel_time)->ArgName("policy")->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
+
+// map construction time and the resident memory it adds against grid size
+static void BM_map_gen(benchmark::State& state) {
+    MapGen::Config config;
+    size_t size = state.range(0);
+    config.rows = size;
+    config.cols = size;
+    config.floors = state.range(1);
+    config.n_bins = size * size / 2;
+    config.n_bots = size;
+    config.seed = 0;
+    config.elevators = {{0, 0}, {size - 1, size - 1}, {0, size - 1}, {size - 1, 0}};
+    size_t resident = 0;
+    for (auto _ : state) {
+        size_t before = residentBytes();
+        MapGen map(config);
+        // freed pages may stay resident, so later iterations can report less
+        size_t after = residentBytes();
+        resident = std::max(resident, after > before ? after - before : 0);
+        benchmark::DoNotOptimize(map.grid.data());
+    }
+    state.counters["nodes"] = size * size * state.range(1);
+    state.counters["rss_mb"] = resident / 1e6;
+}
+BENCHMARK(BM_map_gen)
+        ->ArgNames({"size", "floors"})
+        ->Args({50, 8})
+        ->Args({100, 8})
+        ->Args({250, 8})
+        ->Args({500, 8})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+// map construction from a compiled snapshot, same maps as BM_map_gen
+static void BM_map_snapshot(benchmark::State& state) {
+    MapGen::Config config;
+    size_t size = state.range(0);
+    config.rows = size;
+    config.cols = size;
+    config.floors = state.range(1);
+    config.n_bins = size * size / 2;
+    config.n_bots = size;
+    config.seed = 0;
+    config.elevators = {{0, 0}, {size - 1, size - 1}, {0, size - 1}, {size - 1, 0}};
+    if (!MapSnapshot::save(MapGen(config), "benchmark_map.bin")) {
+        state.SkipWithError("snapshot save failed");
+        return;
+    }
+    for (auto _ : state) {
+        MapSnapshot snapshot("benchmark_map.bin");
+        MapGen map(snapshot);
+        benchmark::DoNotOptimize(map.grid.data());
+    }
+}
+BENCHMARK(BM_map_snapshot)
+        ->ArgNames({"size", "floors"})
+        ->Args({50, 8})
+        ->Args({100, 8})
+        ->Args({250, 8})
+        ->Args({500, 8})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+BENCHMARK_MAIN();
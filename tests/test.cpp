@@ -1,9 +1,84 @@
 #include <gtest/gtest.h>
 #include <swarm_sim/map_gen.hpp>
 #include <swarm_sim/bin_router.hpp>
+#include <swarm_sim/bin_request_queue.hpp>
+#include <swarm_sim/assignment.hpp>
+#include <swarm_sim/batch_runner.hpp>
+#include <swarm_sim/evaluator.hpp>
+#include <swarm_sim/map_snapshot.hpp>
+#include <swarm_sim/travel_time.hpp>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
 
 using namespace swarm_sim;
 
+// bin router settings shared by the tests, a two floor 10x10 map with two elevators
+static BinRouter::Config routerConfig() {
+    BinRouter::Config config;
+    config.elevator_duration = 10.0f;
+    config.fallback_cost = 5000;
+    config.blocking_fallback_cost = 10.0f;
+    config.iterations = 100000;
+    config.planner_config.rounds = 1000;
+    config.planner_config.n_threads = 8;
+    config.planner_config.allow_indefinite_block = false;
+    config.map_gen_config.rows = 10;
+    config.map_gen_config.cols = 10;
+    config.map_gen_config.floors = 2;
+    config.map_gen_config.n_bins = 50;
+    config.map_gen_config.n_bots = 5;
+    config.map_gen_config.elevators = {{0, 0}, {9, 9}};
+    return config;
+}
+
+// cells of the bins and their paths written by the bin planning stage, by bin id
+class BinPathSink : public OutputSink {
+public:
+    using Cells = std::vector<std::array<float, 3>>;
+
+    // bins that stay put have no path rows but still bid on their cell
+    void writeEntity(const OutputEntry& entry) override {
+        if (entry.stage == 0 && entry.type == BinRouter::BIN) {
+            paths[entry.id].push_back({entry.x, entry.y, entry.z});
+        }
+    }
+    void writePath(const OutputEntry& entry) override {
+        if (entry.stage == 0) {
+            paths[entry.id].push_back({entry.x, entry.y, entry.z});
+        }
+    }
+    bool good() const override { return true; }
+
+    std::map<int, Cells> paths;
+};
+
+// every entry written, in order
+class RecordingSink : public OutputSink {
+public:
+    void writeEntity(const OutputEntry& entry) override { entries.push_back(entry); }
+    void writePath(const OutputEntry& entry) override { entries.push_back(entry); }
+    bool good() const override { return true; }
+
+    std::vector<OutputEntry> entries;
+};
+
+// requests moving each bot of the map to the bin with the same index
+static std::vector<MultiPathPlanner::Request> botRequests(const MapGen& map) {
+    PathSearch::Config search_config;
+    search_config.travel_time = WarehouseTravelTime{0};
+    std::vector<MultiPathPlanner::Request> requests;
+    for (size_t i = 0; i < map.bots.size(); ++i) {
+        search_config.agent_id = std::to_string(i);
+        requests.push_back({std::make_shared<const Nodes>(Nodes{map.bins[i]}), FLT_MAX,
+                search_config, {{map.bots[i]}, 1000, 500}});
+    }
+    return requests;
+}
+
 TEST(map_gen, generate) {
     BinRouter::Config config;
     config.elevator_duration = 10.0f;
@@ -42,6 +117,586 @@ TEST(map_gen, generate) {
                     "bin_routes.csv"));
 }
 
+TEST(map_gen, edges) {
+    MapGen map({10, 10, 3, 200, 5, {{0, 0}, {0, 9}, {9, 0}, {9, 9}}, 0});
+    // elevators connect to their neighbors on every floor
+    ASSERT_EQ(map.elevators.size(), 4u);
+    ASSERT_EQ(map.elevators[0], map.at(0, 0, 2));
+    ASSERT_EQ(map.elevators[0]->edges.size(), 6u);
+    ASSERT_EQ(map.at(5, 5, 1)->edges.size(), 4u);
+    ASSERT_EQ(map.at(5, 0, 2)->edges.size(), 3u);
+    // edges are reserved to the exact degree of each node
+    for (auto& node : map.grid) {
+        ASSERT_EQ(node->edges.capacity(), node->edges.size());
+    }
+    ASSERT_EQ(map.node_attributes.capacity(), map.grid.size());
+}
+
+TEST(map_gen, snapshot) {
+    MapGen::Config config;
+    config.rows = 10;
+    config.cols = 8;
+    config.floors = 3;
+    config.n_bins = 40;
+    config.n_bots = 5;
+    config.elevators = {{0, 0}, {7, 9}};
+    config.seed = 1;
+    MapGen map(config);
+    ASSERT_TRUE(MapSnapshot::save(map, "map_snapshot.bin"));
+    ASSERT_FALSE(MapSnapshot("map_snapshot_missing.bin").good());
+
+    MapSnapshot snapshot("map_snapshot.bin");
+    ASSERT_TRUE(snapshot.good());
+    MapGen loaded(snapshot);
+    ASSERT_EQ(loaded.grid.size(), map.grid.size());
+    for (size_t i = 0; i < map.grid.size(); ++i) {
+        auto& node = map.grid[i];
+        auto& loaded_node = loaded.grid[i];
+        ASSERT_EQ(map.find(loaded_node->position), node);
+        ASSERT_EQ(node->state, loaded_node->state);
+        ASSERT_EQ(node->edges.size(), loaded_node->edges.size());
+        ASSERT_EQ(MapGen::attributes(node).elevator, MapGen::attributes(loaded_node).elevator);
+    }
+    // elevators stay shared between floors
+    ASSERT_EQ(loaded.at(7, 9, 0), loaded.at(7, 9, 2));
+    ASSERT_EQ(loaded.elevators.size(), 2u);
+    ASSERT_EQ(loaded.elevator_distances, map.elevator_distances);
+    ASSERT_EQ(loaded.bins.size(), map.bins.size());
+    ASSERT_EQ(loaded.bots.size(), map.bots.size());
+    for (size_t i = 0; i < map.bins.size(); ++i) {
+        ASSERT_EQ(map.find(loaded.bins[i]->position), map.bins[i]);
+    }
+    ASSERT_TRUE(MapGen(snapshot, false).bins.empty());
+
+    // corrupt copies with out of range references are rejected
+    std::ifstream input("map_snapshot.bin", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    auto base = reinterpret_cast<const char*>(&snapshot.getHeader());
+    const auto corrupt = [&bytes, base](const void* field, const void* value, size_t size) {
+        auto corrupted = bytes;
+        corrupted.replace(static_cast<const char*>(field) - base, size,
+                static_cast<const char*>(value), size);
+        std::ofstream("map_snapshot_corrupt.bin", std::ios::binary) << corrupted;
+        return MapSnapshot("map_snapshot_corrupt.bin").good();
+    };
+    uint32_t n_cells = snapshot.getHeader().n_cells;
+    uint32_t rows = snapshot.getHeader().rows;
+    ASSERT_FALSE(corrupt(&snapshot.edges[3], &n_cells, sizeof(n_cells)));
+    ASSERT_FALSE(corrupt(&snapshot.bins[0], &n_cells, sizeof(n_cells)));
+    ASSERT_FALSE(corrupt(&snapshot.attributes[5].row, &rows, sizeof(rows)));
+    ASSERT_FALSE(corrupt(&snapshot.edge_offsets[1], &snapshot.edge_offsets[n_cells], 8));
+    ASSERT_TRUE(corrupt(&snapshot.bins[0], &snapshot.bins[1], sizeof(uint32_t)));
+
+    auto router_config = routerConfig();
+    router_config.planner_config.n_threads = 4;
+    BinRouter bin_router(std::move(router_config), snapshot);
+    NullSink sink;
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.solve({{0, 3, 0, 0}, {1, 6, 1, 1}}, sink));
+}
+
+TEST(travel_time, elevator_detour) {
+    MapGen map({5, 5, 2, 0, 0, {{0, 0}}, 0});
+    float d = 10.0f;
+    WarehouseTravelTime manhattan{d};
+    WarehouseTravelTime detour{d, &map};
+    // the only elevator is in the corner, so changing floors walks there and back
+    auto a = map.at(4, 4, 0);
+    auto b = map.at(4, 4, 1);
+    ASSERT_EQ(manhattan(nullptr, a, b), d);
+    ASSERT_EQ(detour(nullptr, a, b), 16 + d);
+    ASSERT_EQ(detour(nullptr, a, b),
+            map.elevatorDetour(MapGen::attributes(a), MapGen::attributes(b)) + d);
+    auto c = map.at(2, 0, 0);
+    auto e = map.at(3, 0, 1);
+    ASSERT_EQ(manhattan(nullptr, c, e), 1 + d);
+    ASSERT_EQ(detour(nullptr, c, e), 5 + d);
+    // on the straight line through the elevator both agree
+    auto f = map.at(0, 3, 1);
+    ASSERT_EQ(detour(nullptr, c, f), manhattan(nullptr, c, f));
+    // same floor and adjacent queries are unchanged
+    ASSERT_EQ(detour(nullptr, a, c), manhattan(nullptr, a, c));
+    ASSERT_EQ(detour(a, a, map.at(3, 4, 0)), manhattan(a, a, map.at(3, 4, 0)));
+    ASSERT_EQ(detour(nullptr, map.elevators[0], b), manhattan(nullptr, map.elevators[0], b));
+    // exiting an elevator rides it
+    ASSERT_EQ(detour(b, map.elevators[0], map.at(1, 0, 1)), 1 + d);
+    ASSERT_EQ(detour(nullptr, map.elevators[0], map.at(1, 0, 1)), 1 + d);
+}
+
+TEST(bin_router, robot_map_reuse) {
+    // a single bot moves one bin per stage
+    auto config = routerConfig();
+    config.map_gen_config.n_bots = 1;
+    config.map_gen_config.seed = 0;
+    BinRouter bin_router(std::move(config));
+    NullSink sink;
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.solve({{0, 3, 0, 0}, {1, 6, 0, 0}}, sink));
+    ASSERT_GE(bin_router.getStats().stages.size(), 3u);
+    // only bids of the last stage's paths are left on the reused graph
+    auto& robot_map = bin_router.getRobotMap(0);
+    auto& paths = bin_router.getRobotPlanner(0).getPathSync().getPaths();
+    ASSERT_EQ(paths.size(), 1u);
+    for (auto& node : robot_map.grid) {
+        for (auto& [price, bid] : node->auction.getBids()) {
+            if (bid.bidder.empty()) {
+                continue;
+            }
+            auto found = paths.find(bid.bidder);
+            ASSERT_TRUE(found != paths.end());
+            auto& path = found->second.path;
+            ASSERT_TRUE(std::any_of(path.begin(), path.end(), [&](const Visit& visit) {
+                return visit.node == node && visit.price == price;
+            }));
+        }
+    }
+}
+
+TEST(bin_router, warm_start) {
+    BinRouter bin_router(routerConfig());
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.planBinPaths({{0, 3, 0, 0}, {1, 6, 0, 1}}));
+    BinPathSink before;
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.planStages(before));
+    auto before_results = bin_router.getStats().stages[0].agents;
+    // change requests against the existing solution
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.cancelBinRequests({1}));
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.addBinRequests({{2, 6, 0, 0}}));
+    ASSERT_EQ(BinRouter::REQUEST_BIN_ID_OUT_OF_RANGE, bin_router.addBinRequests({{50, 1, 1, 0}}));
+    BinPathSink after;
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.planStages(after));
+    auto& after_results = bin_router.getStats().stages[0].agents;
+    ASSERT_EQ(before_results.size(), after_results.size());
+
+    // the changed bins are replanned
+    size_t n_bins = after_results.size();
+    std::vector<uint8_t> replanned(n_bins), touched(n_bins);
+    for (size_t i = 0; i < n_bins; ++i) {
+        replanned[i] = after_results[i].replans > before_results[i].replans;
+    }
+    ASSERT_TRUE(replanned[1] && replanned[2]);
+    touched[1] = touched[2] = true;
+    // other bins are only replanned if they share cells with a bin the changes reached
+    const auto shares_cells = [&](int a, int b) {
+        for (auto* sink : {&before, &after}) {
+            for (auto& cell : sink->paths[a]) {
+                for (auto* other : {&before, &after}) {
+                    auto& cells = other->paths[b];
+                    if (std::find(cells.begin(), cells.end(), cell) != cells.end()) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    };
+    for (bool grown = true; grown;) {
+        grown = false;
+        for (size_t i = 0; i < n_bins; ++i) {
+            for (size_t j = 0; replanned[i] && !touched[i] && j < n_bins; ++j) {
+                if (touched[j] && shares_cells(i, j)) {
+                    touched[i] = grown = true;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < n_bins; ++i) {
+        ASSERT_TRUE(!replanned[i] || touched[i]) << "bin " << i;
+        // bins that were not replanned keep their paths
+        if (!replanned[i]) {
+            ASSERT_EQ(before.paths[i], after.paths[i]) << "bin " << i;
+        }
+    }
+}
+
+TEST(bin_router, pipelined) {
+    // a single planner thread keeps both solves deterministic
+    auto config = routerConfig();
+    config.planner_config.n_threads = 1;
+    config.map_gen_config.seed = 0;
+    std::vector<BinRouter::BinRequest> requests = {
+            {0, 3, 0, 0}, {1, 6, 0, 0}, {2, 3, 5, 1}, {3, 6, 5, 1}, {4, 8, 2, 0}};
+    RecordingSink sequential;
+    BinRouter sequential_router(config);
+    ASSERT_EQ(BinRouter::SUCCESS, sequential_router.solve(requests, sequential));
+
+    config.pipelined = true;
+    RecordingSink pipelined;
+    BinRouter pipelined_router(config);
+    ASSERT_EQ(BinRouter::SUCCESS, pipelined_router.solve(requests, pipelined));
+
+    // saving a stage while the next is planned must not change what is written
+    ASSERT_EQ(sequential_router.getStats().stages.size(),
+            pipelined_router.getStats().stages.size());
+    ASSERT_EQ(sequential.entries.size(), pipelined.entries.size());
+    for (size_t i = 0; i < sequential.entries.size(); ++i) {
+        ASSERT_EQ(0, memcmp(&sequential.entries[i], &pipelined.entries[i], sizeof(OutputEntry)))
+                << "entry " << i;
+    }
+}
+
+TEST(bin_router, stream) {
+    BinRouter bin_router(routerConfig());
+    BinRequestQueue queue;
+    std::thread producer([&queue]() {
+        queue.push({0, 3, 0, 0});
+        queue.push({50, 1, 1, 0});
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        queue.push({1, 6, 0, 1});
+        // replaces the previous request of bin 1
+        queue.push({1, 6, 0, 0});
+        queue.close();
+    });
+    CsvSink sink("bin_routes_stream.csv");
+    auto error = bin_router.stream(queue, sink, 0.01);
+    producer.join();
+    ASSERT_EQ(BinRouter::SUCCESS, error);
+    auto& stats = bin_router.getStreamStats();
+    ASSERT_EQ(stats.rejected, 2u);
+    ASSERT_EQ(stats.latencies.size(), 2u);
+    ASSERT_GE(stats.cycles, 1u);
+    ASSERT_EQ(bin_router.getMap().bins[1], bin_router.getMap().at(6, 0, 0));
+}
+
+TEST(bin_router, partition_floors) {
+    auto config = routerConfig();
+    config.partition_floors = true;
+    config.map_gen_config.floors = 3;
+    config.map_gen_config.n_bins = 100;
+    config.map_gen_config.seed = 0;
+    BinRouter bin_router(std::move(config));
+    // bins staying on their floor and bins moving to the floor below
+    std::vector<BinRouter::BinRequest> requests;
+    for (size_t bin_id = 0; bin_id < 4; ++bin_id) {
+        auto& position = bin_router.getMap().bins[bin_id]->position;
+        size_t floor = static_cast<size_t>(position.get<2>());
+        requests.push_back({bin_id, bin_id + 3, 5, bin_id % 2 && floor ? floor - 1 : floor});
+    }
+    ASSERT_EQ(BinRouter::SUCCESS, bin_router.solve(requests, "bin_routes_partitioned.csv"));
+}
+
+TEST(multi_path_planner, provided_pool) {
+    MapGen map({10, 10, 1, 5, 5, {}, 0});
+    auto requests = botRequests(map);
+    MultiPathPlanner::Config config;
+    config.rounds = 100;
+    config.n_threads = 4;
+    // a smaller provided pool is kept and bounds the threads of the run
+    auto thread_pool = std::make_shared<ThreadPool>(1);
+    MultiPathPlanner planner(thread_pool);
+    ASSERT_EQ(PathSearch::SUCCESS, planner.plan(config, requests));
+    ASSERT_EQ(planner.getThreadPool(), thread_pool);
+    ASSERT_EQ(planner.getStats().threads.size(), 2u);
+}
+
+TEST(multi_path_planner, deadline) {
+    MapGen::Config map_config{10, 10, 1, 5, 5, {}, 0};
+    MapGen map(map_config);
+    auto requests = botRequests(map);
+    MultiPathPlanner::Config config;
+    config.rounds = 100;
+    config.n_threads = 2;
+    // deadline passed before planning started, every agent stays at its source
+    config.deadline = std::chrono::steady_clock::now();
+    MultiPathPlanner planner;
+    ASSERT_EQ(PathSearch::SUCCESS, planner.plan(config, requests));
+    ASSERT_EQ(MultiPathPlanner::DEADLINE_REACHED, planner.getStats().convergence);
+    for (size_t i = 0; i < requests.size(); ++i) {
+        ASSERT_TRUE(planner.getResults()[i].deferred);
+        ASSERT_LE(planner.getAgentIndex().getPath(i).size(), 1u);
+    }
+}
+
+TEST(multi_path_planner, deferred_block_corridor) {
+    // agents meet head on in a corridor without room to pass
+    MapGen map({1, 6, 1, 0, 0, {}, 0});
+    std::vector<std::pair<size_t, size_t>> moves = {{0, 5}, {1, 4}, {5, 0}};
+    PathSearch::Config search_config;
+    search_config.travel_time = WarehouseTravelTime{0};
+    std::vector<MultiPathPlanner::Request> requests;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        search_config.agent_id = std::to_string(i);
+        auto dst = std::make_shared<const Nodes>(Nodes{map.at(moves[i].second, 0, 0)});
+        Nodes src = {map.at(moves[i].first, 0, 0)};
+        requests.push_back({dst, FLT_MAX, search_config, {src, 1000, 500}});
+    }
+    MultiPathPlanner::Config config;
+    config.rounds = 1;
+    config.n_threads = 1;
+    config.allow_indefinite_block = false;
+    MultiPathPlanner planner;
+    planner.plan(config, requests);
+    auto& results = planner.getResults();
+    auto& agent_index = planner.getAgentIndex();
+    Nodes blocked;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (!results[i].deferred) {
+            continue;
+        }
+        // deferred agents hold the highest bid on their source
+        auto& path = agent_index.getPath(i);
+        ASSERT_EQ(path.size(), 1u);
+        ASSERT_EQ(path.front().node, requests[i].args.src.front());
+        ASSERT_TRUE(path.front().node->auction.getHigherBid(path.front().price) ==
+                    path.front().node->auction.getBids().end());
+        blocked.push_back(path.front().node);
+    }
+    // no other committed path moves through a deferred agent
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (results[i].deferred || results[i].sync_error) {
+            continue;
+        }
+        for (auto& visit : agent_index.getPath(i)) {
+            ASSERT_TRUE(std::find(blocked.begin(), blocked.end(), visit.node) == blocked.end());
+        }
+    }
+}
+
+TEST(multi_path_planner, batched_commits) {
+    MapGen::Config map_config{10, 10, 1, 20, 20, {}, 0};
+    MapGen map(map_config);
+    auto requests = botRequests(map);
+    MultiPathPlanner::Config config;
+    config.rounds = 100;
+    config.n_threads = 4;
+    config.commit_batch = 4;
+    MultiPathPlanner planner;
+    ASSERT_EQ(PathSearch::SUCCESS, planner.plan(config, requests));
+    auto& stats = planner.getStats();
+    ASSERT_EQ(MultiPathPlanner::CONVERGED, stats.convergence);
+    ASSERT_GE(stats.batches, 1u);
+    ASSERT_LE(stats.commits + stats.rejected, config.rounds * requests.size());
+}
+
+TEST(multi_path_planner, batched_contention) {
+    // every bot competes for every bin of a crowded map, so queued paths go stale
+    MapGen map({4, 4, 1, 6, 6, {}, 0});
+    auto requests = botRequests(map);
+    auto bins = std::make_shared<const Nodes>(map.bins);
+    for (auto& request : requests) {
+        request.dst = bins;
+    }
+    MultiPathPlanner::Config config;
+    config.rounds = 100;
+    config.n_threads = 8;
+    config.allow_indefinite_block = false;
+    MultiPathPlanner planner;
+    // small batches leave threads idle while another one commits, a candidate queued then
+    // must still be committed or the run would never end
+    for (size_t batch : {1, 2, 3}) {
+        config.commit_batch = batch;
+        for (int run = 0; run < 20; ++run) {
+            planner.plan(config, requests);
+            auto& stats = planner.getStats();
+            ASSERT_NE(MultiPathPlanner::SEARCH_FAILED, stats.convergence);
+            ASSERT_LE(stats.commits + stats.rejected, config.rounds * requests.size());
+        }
+    }
+}
+
+// commits paths with hand picked bids, agent ids are the path indices
+static void commitPaths(
+        const std::vector<Path>& paths, PathSync& path_sync, AgentIndex& agent_index) {
+    for (size_t i = 0; i < paths.size(); ++i) {
+        agent_index.insert(std::to_string(i));
+        ASSERT_EQ(PathSync::SUCCESS, path_sync.updatePath(std::to_string(i), paths[i], i));
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        agent_index.bind(i, path_sync);
+    }
+}
+
+TEST(dependency_graph, layers) {
+    MapGen::Config map_config{2, 5, 1, 0, 0, {}, 0};
+    MapGen map(map_config);
+    const auto visit = [&map](size_t col, size_t row, float price) {
+        Visit v{map.at(col, row, 0)};
+        v.price = price;
+        return v;
+    };
+    // agent 0 follows agent 1 along the corridor, agent 2 is on its own row
+    // agent 3 stays put and is left out
+    std::vector<Path> paths = {
+            {visit(0, 0, 1), visit(1, 0, 1), visit(2, 0, 1)},
+            {visit(2, 0, 2), visit(3, 0, 1), visit(4, 0, 1)},
+            {visit(0, 1, 1), visit(1, 1, 1)},
+            {visit(3, 1, 1)},
+    };
+    PathSync path_sync;
+    AgentIndex agent_index;
+    commitPaths(paths, path_sync, agent_index);
+    DependencyGraph dependencies;
+    dependencies.build(path_sync, agent_index);
+    ASSERT_EQ(dependencies.getLayerCount(), 2u);
+    ASSERT_EQ(dependencies.getLayer(0), 1u);
+    ASSERT_EQ(dependencies.getLayer(1), 0u);
+    ASSERT_EQ(dependencies.getLayer(2), 0u);
+
+    // the lowest layer is ready first, agent 0 waits until agent 1 completed
+    std::vector<size_t> ready;
+    dependencies.takeReady(4, ready);
+    ASSERT_EQ(ready, (std::vector<size_t>{1, 2}));
+    dependencies.retry(2);
+    dependencies.complete(1);
+    dependencies.takeReady(4, ready);
+    ASSERT_EQ(ready, (std::vector<size_t>{2, 0}));
+    dependencies.complete(2);
+    ASSERT_FALSE(dependencies.done());
+    dependencies.complete(0);
+    ASSERT_TRUE(dependencies.done());
+}
+
+TEST(dependency_graph, cycle) {
+    MapGen::Config map_config{1, 2, 1, 0, 0, {}, 0};
+    MapGen map(map_config);
+    const auto visit = [&map](size_t col, float price) {
+        Visit v{map.at(col, 0, 0)};
+        v.price = price;
+        return v;
+    };
+    // two agents swapping cells each wait for the other to leave
+    std::vector<Path> paths = {
+            {visit(0, 2), visit(1, 1)},
+            {visit(1, 2), visit(0, 1)},
+    };
+    PathSync path_sync;
+    AgentIndex agent_index;
+    commitPaths(paths, path_sync, agent_index);
+    DependencyGraph dependencies;
+    dependencies.build(path_sync, agent_index);
+    // the dependency closing the cycle is dropped, so both agents are still scheduled
+    ASSERT_EQ(dependencies.getLayerCount(), 2u);
+    ASSERT_EQ(dependencies.getLayer(1), 0u);
+    ASSERT_EQ(dependencies.getLayer(0), 1u);
+    std::vector<size_t> ready;
+    dependencies.takeReady(2, ready);
+    ASSERT_EQ(ready, std::vector<size_t>{1});
+    dependencies.complete(1);
+    dependencies.takeReady(2, ready);
+    ASSERT_EQ(ready, std::vector<size_t>{0});
+    dependencies.complete(0);
+    ASSERT_TRUE(dependencies.done());
+}
+
+TEST(evaluator, path_metrics) {
+    MapGen::Config map_config{1, 5, 2, 0, 0, {{0, 0}}, 0};
+    MapGen map(map_config);
+    Evaluator evaluator(map, 10.0f);
+    // waits 2 to enter the elevator then rides it to the next floor
+    Path path = {{map.at(2, 0, 0), 0}, {map.at(1, 0, 0), 1}, {map.at(0, 0, 0), 4},
+            {map.at(1, 0, 1), 15}};
+    PlanMetrics metrics;
+    auto agent = evaluator.evaluate(path, &metrics);
+    ASSERT_FLOAT_EQ(agent.travel_time, 13);
+    ASSERT_FLOAT_EQ(agent.wait_time, 2);
+    ASSERT_FLOAT_EQ(agent.finish_time, 15);
+    ASSERT_EQ(agent.elevator_rides, 1u);
+    ASSERT_FLOAT_EQ(metrics.elevator_wait_time, 2);
+    ASSERT_EQ(metrics.elevator_usage, std::vector<size_t>{1});
+    ASSERT_FLOAT_EQ(metrics.makespan, 15);
+    metrics.agents.push_back(agent);
+
+    // a second agent staying in place does not extend the makespan
+    PlanMetrics stage;
+    Path wait = {{map.at(3, 0, 1), 0}, {map.at(3, 0, 1), 5}};
+    stage.agents.push_back(evaluator.evaluate(wait, &stage));
+    ASSERT_FLOAT_EQ(stage.wait_time, 5);
+    metrics.append(stage);
+    ASSERT_FLOAT_EQ(metrics.makespan, 20);
+    ASSERT_FLOAT_EQ(metrics.agents[0].finish_time, 20);
+    ASSERT_FLOAT_EQ(metrics.agents[0].wait_time, 7);
+}
+
+TEST(batch_runner, scenarios) {
+    BatchRunner::Config config;
+    config.n_threads = 4;
+    BatchRunner batch_runner(config);
+    std::istringstream scenarios(
+            "# comment line\n"
+            "name=a rows=10 cols=10 floors=2 elevators=0:0,9:9 bins=50 bots=5 requests=4 "
+            "threads=2\n"
+            "\n"
+            "name=b rows=10 cols=10 floors=2 elevators=0:0 bins=50 bots=5 request=0:3:0:0 "
+            "threads=8\n"
+            "name=c bins=20 requests=2\n");
+    ASSERT_EQ(BatchRunner::SUCCESS, batch_runner.parseScenarios(scenarios));
+    ASSERT_EQ(batch_runner.getScenarios().size(), 3u);
+    ASSERT_EQ(batch_runner.getScenarios()[1].requests.size(), 1u);
+    std::istringstream invalid("name=d rows=10\nname=e rows=0\n");
+    size_t error_line = 0;
+    ASSERT_EQ(BatchRunner::SCENARIO_PARSE_FAIL, batch_runner.parseScenarios(invalid, &error_line));
+    ASSERT_EQ(error_line, 2u);
+    // elevators must lie on the grid, whichever order the keys come in
+    std::istringstream off_grid("elevators=9:4 cols=10 rows=5\nelevators=0:5 cols=10 rows=5\n");
+    ASSERT_EQ(BatchRunner::SCENARIO_PARSE_FAIL, batch_runner.parseScenarios(off_grid, &error_line));
+    ASSERT_EQ(error_line, 2u);
+    ASSERT_EQ(batch_runner.getScenarios().size(), 3u);
+
+    auto& results = batch_runner.run();
+    ASSERT_EQ(results.size(), 3u);
+    // the widest scenario asks for 8 threads so the 4 thread budget allows one at a time
+    ASSERT_EQ(batch_runner.getParallelism(), 1u);
+    for (auto& result : results) {
+        ASSERT_EQ(BinRouter::SUCCESS, result.error);
+        ASSERT_LE(result.n_threads, 4u);
+    }
+    ASSERT_EQ(results[1].name, "b");
+    ASSERT_EQ(BatchRunner::SUCCESS, batch_runner.saveResults("batch_results.csv"));
+}
+
+TEST(assignment, hungarian) {
+    // greedy would assign row 0 to column 0 for a total of 1 + 4 + 5
+    std::vector<float> costs = {
+            1, 2, 9,  //
+            2, 5, 4,  //
+            9, 5, 4,  //
+    };
+    ASSERT_EQ(solveAssignment(costs, 3, 3), (std::vector<size_t>{1, 0, 2}));
+    // more rows than columns leaves a row unassigned
+    ASSERT_EQ(solveAssignment({3, 1, 2, 8, 4, 9}, 3, 2),
+            (std::vector<size_t>{1, 0, NOT_ASSIGNED}));
+    // more columns than rows
+    ASSERT_EQ(solveAssignment({3, 1, 2, 8, 2, 9}, 2, 3), (std::vector<size_t>{2, 1}));
+}
+
+TEST(output_sink, binary_deltas) {
+    {
+        BinarySink sink("bin_routes.bin", 4);
+        ASSERT_TRUE(sink.good());
+        for (int stage = 0; stage < 3; ++stage) {
+            // only the first bin moves between stages
+            for (int id = 0; id < 3; ++id) {
+                sink.writeEntity({stage, BinRouter::BIN, id, id ? 0.0f : stage, 1, 0, 0});
+            }
+            sink.writePath({stage, BinRouter::PATH, 0, 1, 2, 0, 0.25f});
+        }
+    }
+    BinaryReader reader("bin_routes.bin");
+    ASSERT_TRUE(reader.good());
+    size_t entity_rows = 0;
+    for (auto& block : reader.getBlocks()) {
+        entity_rows += block.kind == BinarySink::ENTITIES ? block.n_rows : 0;
+    }
+    ASSERT_EQ(entity_rows, 5u);
+    auto entities = reader.getEntities(2);
+    ASSERT_EQ(entities.size(), 3u);
+    ASSERT_EQ(entities[0].x, 2.0f);
+    ASSERT_EQ(reader.getPaths(1).size(), 1u);
+}
+
+TEST(tracer, chrome_export) {
+    auto& tracer = Tracer::instance();
+    tracer.clear(2);
+    // ring buffer keeps only the latest two events
+    tracer.record(Tracer::BEGIN, "dropped");
+    tracer.record(Tracer::BEGIN, "replan", 1);
+    tracer.record(Tracer::END, "replan", 1, 2);
+    ASSERT_TRUE(tracer.exportChromeTrace("trace.json"));
+    std::ifstream file("trace.json");
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(json.find("dropped"), std::string::npos);
+    ASSERT_NE(json.find("\"name\":\"replan\",\"ph\":\"B\""), std::string::npos);
+    ASSERT_NE(json.find("\"args\":{\"id\":1,\"value\":2}"), std::string::npos);
+    tracer.clear();
+}
+
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();